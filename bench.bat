@@ -0,0 +1,21 @@
+@echo off
+echo ========================================
+echo    GitHub Simulator - Benchmarks
+echo ========================================
+echo.
+echo Compiling benchmarks...
+g++ -std=c++17 -O2 -pthread -o benchmarks benchmarks.cpp -lws2_32
+if errorlevel 1 (
+    echo.
+    echo Compilation failed!
+    echo Make sure you have g++ installed
+    pause
+    exit /b 1
+)
+
+echo Compilation successful!
+echo.
+benchmarks.exe --json benchmark_results.json %*
+echo Core operation results written to benchmark_results.json
+echo.
+pause
@@ -0,0 +1,562 @@
+// Microbenchmarks for the GitHub simulator engine.
+// Build: g++ -std=c++17 -O2 -pthread -o benchmarks benchmarks.cpp (add -lws2_32 on Windows)
+// Run:   ./benchmarks [--json results.json] [search routing body tasks pool history metrics http core]
+#define GITHUB_SIM_NO_MAIN
+#include "main.cpp"
+#include <chrono>
+#include <random>
+
+// -------------------- Timing Helpers --------------------
+// Run fn repeatedly for at least minMillis and return nanoseconds per call. Calls
+// run in growing batches between clock reads so the clock does not dominate
+// routines that take only tens of nanoseconds.
+template <typename Fn>
+double timePerCall(Fn fn, double minMillis = 200) {
+    using clock = chrono::steady_clock;
+    size_t iterations = 0, batch = 1;
+    auto start = clock::now();
+    double elapsed = 0;
+    do {
+        for (size_t i = 0; i < batch; i++) fn();
+        iterations += batch;
+        if (batch < 1024) batch *= 2;
+        elapsed = chrono::duration<double, milli>(clock::now() - start).count();
+    } while (elapsed < minMillis);
+    return elapsed * 1e6 / iterations;
+}
+
+// Keeps results observable so the optimizer cannot drop the work
+static volatile size_t benchSink = 0;
+
+// -------------------- Case-Insensitive Search --------------------
+// The search path used before TextSearch: lowercase copies of both strings, then find
+static size_t findLowerCopy(const string& haystack, const string& term) {
+    string haystackLower = haystack;
+    transform(haystackLower.begin(), haystackLower.end(), haystackLower.begin(), ::tolower);
+    string termLower = term;
+    transform(termLower.begin(), termLower.end(), termLower.begin(), ::tolower);
+    return haystackLower.find(termLower);
+}
+
+void benchTextSearch() {
+    mt19937 rng(42);
+    const char* words[] = {"function", "return", "const", "Value", "index", "Branch", "merge", "FILE", "commit", "\n", " ", "{", "}"};
+    cout << "\n=== Case-insensitive substring search (no match, full scan) ===\n";
+    cout << "haystack    needle   lowercase+find      TextSearch   speedup\n";
+    for (size_t size : {256, 4096, 65536, 1 << 20}) {
+        string haystack;
+        while (haystack.size() < size) haystack += words[rng() % 13];
+        haystack.resize(size);
+        for (string needle : {string("Zq"), string("mergeX"), string("BranchManager::mergeBranchZ")}) {
+            double before = timePerCall([&] { benchSink += findLowerCopy(haystack, needle); });
+            double after = timePerCall([&] { benchSink += TextSearch::findIgnoreCase(haystack, needle); });
+            printf("%8zu  %8zu  %10.1f ns  %10.1f ns  %7.1fx\n", size, needle.size(), before, after, before / after);
+        }
+    }
+}
+
+// -------------------- Request Routing --------------------
+// Dispatch as handleRequest did it before the route trie: strings passed by
+// value, then a chain of find() checks in order. Returns the branch it took.
+static int routeLegacy(string method, string endpoint, string data) {
+    (void)data;
+    if (method == "GET" && endpoint == "/api/repositories") return 0;
+    else if (method == "GET" && endpoint.find("/api/repositories?") == 0) return 1;
+    else if (method == "GET" && endpoint == "/api/undo-redo-stacks") return 2;
+    else if (method == "POST" && endpoint == "/api/repositories") return 3;
+    else if (method == "DELETE" && endpoint.find("/api/repositories/") == 0) return 4;
+    else if (method == "POST" && endpoint.find("/api/repositories/") == 0 && endpoint.find("/files") != string::npos) return 5;
+    else if (method == "POST" && endpoint == "/api/undo") return 6;
+    else if (method == "POST" && endpoint == "/api/redo") return 7;
+    else if (method == "POST" && endpoint.find("/api/repositories/") == 0 && endpoint.find("/branches") != string::npos) return 8;
+    else if (method == "PUT" && endpoint.find("/api/repositories/") == 0 && endpoint.find("/branches/switch") != string::npos) return 9;
+    else if (method == "POST" && endpoint.find("/api/repositories/") == 0 && endpoint.find("/branches/merge") != string::npos) return 10;
+    else if (method == "GET" && endpoint.find("/api/repositories/") == 0 && endpoint.find("/branches") != string::npos) return 11;
+    else if (method == "GET" && endpoint.find("/api/search/repos/") == 0) return 12;
+    else if (method == "GET" && endpoint.find("/api/search/files/") == 0) return 13;
+    return -1;
+}
+
+void benchRouting() {
+    const RouteTrie<GitHub::Route>& routes = GitHub::routes();
+    string body(2048, 'x');     // Handlers got the body by value too
+    struct Case { const char* method; string target; };
+    vector<Case> cases = {
+        {"GET", "/api/repositories"},
+        {"POST", "/api/repositories/LeetCode/files"},
+        {"PUT", "/api/repositories/LeetCode/branches/switch"},
+        {"GET", "/api/search/files/LeetCode/twoSum?content=true"},
+        {"GET", "/api/repositories/a-rather-long-repository-name-for-testing/branches"},
+        {"GET", "/api/unknown/endpoint/that/matches/nothing"},
+    };
+    cout << "\n=== Request routing (dispatch only) ===\n";
+    cout << "route                                                                       if/else chain    route trie   speedup\n";
+    for (const Case& c : cases) {
+        double before = timePerCall([&] { benchSink += routeLegacy(c.method, c.target, body); });
+        double after = timePerCall([&] {
+            GitHub::Route route{NULL, 0};
+            RouteParams params;
+            benchSink += routes.match(c.method, c.target, route, params);
+        });
+        string label = string(c.method) + " " + c.target;
+        printf("%-72s  %10.1f ns  %10.1f ns  %7.1fx\n", label.c_str(), before, after, before / after);
+    }
+}
+
+// -------------------- Request Body Parsing --------------------
+// How the createFile handler read its body before FormFields: the body copied
+// into a string, then find/substr per field
+static size_t parseBodyLegacy(string_view body) {
+    string data(body);
+    size_t namePos = data.find("name=");
+    size_t contentPos = data.find("content=");
+    string fileName = data.substr(namePos + 5, data.find("&", namePos) - namePos - 5);
+    string content = data.substr(contentPos + 8);
+    return fileName.size() + content.size();
+}
+
+void benchBodyParsing() {
+    cout << "\n=== Request body parsing (POST /files) ===\n";
+    cout << "body bytes   find/substr     FormFields   speedup\n";
+    for (size_t size : {64, 4096, 262144}) {
+        string body = "name=src%2Fmain.cpp&content=" + string(size, 'x');
+        vector<char> buffer(body.size());
+        double before = timePerCall([&] { benchSink += parseBodyLegacy(body); });
+        // The memcpy stands in for the bytes arriving in the connection buffer,
+        // since parsing decodes over them
+        double after = timePerCall([&] {
+            memcpy(buffer.data(), body.data(), body.size());
+            FormFields form;
+            form.parse(buffer.data(), buffer.size());
+            benchSink += form.get("name").size() + form.get("content").size();
+        });
+        printf("%10zu  %10.1f ns  %10.1f ns  %7.1fx\n", body.size(), before, after, before / after);
+    }
+}
+
+// -------------------- Node Pool --------------------
+// A 100k-file branch with its nodes from the heap (a tree without a pool) and
+// from a repository's NodePool: build it, edit half the files on a copy, walk it
+// and drop both trees
+void benchNodePool() {
+    cout << "\n=== File tree nodes, 100k files (ms) ===\n";
+    cout << "nodes     build    edit copy    walk x10     destroy\n";
+    const size_t kFiles = 100000;
+    vector<string> names;
+    for (size_t i = 0; i < kFiles; i++) names.push_back("src/dir" + to_string(i % 97) + "/file" + to_string(i) + ".cpp");
+    BlobRef blob = BlobStore::instance().intern("int main() {}\n");
+    auto since = [](chrono::steady_clock::time_point start) {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    };
+    for (int pooled = 0; pooled < 2; pooled++) {
+        unique_ptr<NodePool> pool(pooled ? new NodePool() : NULL);
+        unique_ptr<FileTree> tree(new FileTree());
+        tree->pool = pool.get();
+        auto start = chrono::steady_clock::now();
+        for (const string& name : names) tree->put(name, blob);
+        double build = since(start);
+
+        FileTree copy = *tree;
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < kFiles; i += 2) copy.put(names[i], blob);
+        double edit = since(start);
+
+        start = chrono::steady_clock::now();
+        for (int k = 0; k < 10; k++) tree->forEach([](const File& f) { benchSink += f.name.size(); });
+        double walk = since(start);
+
+        start = chrono::steady_clock::now();
+        copy.clear();
+        tree.reset();
+        pool.reset();
+        double destroy = since(start);
+        printf("%-6s %9.1f  %11.1f  %10.1f  %10.1f\n", pooled ? "pool" : "heap", build, edit, walk, destroy);
+    }
+}
+
+// -------------------- Commit History --------------------
+// CommitHistory before the columnar layout: a linked list of three-string
+// nodes, with the date formatted when each commit is made
+struct LinkedCommit {
+    string action, user, date;
+    LinkedCommit* next = NULL;
+};
+
+struct LinkedCommitHistory {
+    LinkedCommit* head = NULL;
+    LinkedCommit* tail = NULL;
+    mutex lock;
+
+    ~LinkedCommitHistory() {
+        while (head) { LinkedCommit* next = head->next; delete head; head = next; }
+    }
+
+    void addCommit(string action, string user) {
+        lock_guard<mutex> guard(lock);
+        LinkedCommit* c = new LinkedCommit{action, user, formatTime(time(0))};
+        if (!head) head = tail = c;
+        else { tail->next = c; tail = c; }
+    }
+};
+
+void benchCommitHistory() {
+    cout << "\n=== Commit history (ms) ===\n";
+    cout << "layout      commits    append    count by author    scan MB/s\n";
+    const char* users[] = {"Shiwani", "alice", "bob", "carol"};
+    auto since = [](chrono::steady_clock::time_point start) {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    };
+    auto action = [](size_t i) { return "Edited File: src/file" + to_string(i % 5000) + ".cpp in branch main"; };
+
+    const size_t kLinked = 2000000;
+    {
+        LinkedCommitHistory history;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < kLinked; i++) history.addCommit(action(i), users[i % 4]);
+        double append = since(start);
+        start = chrono::steady_clock::now();
+        size_t count = 0;
+        for (LinkedCommit* c = history.head; c; c = c->next) count += c->user == "alice";
+        double scan = since(start);
+        benchSink += count;
+        printf("%-10s %8zu  %8.1f  %17.2f  %11s\n", "linked", kLinked, append, scan, "-");
+    }
+    for (size_t n : {kLinked, (size_t)10000000}) {
+        CommitHistory history;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < n; i++) history.addCommit(action(i), users[i % 4], time(0));
+        double append = since(start);
+        Symbol alice("alice");
+        start = chrono::steady_clock::now();
+        size_t count = 0;
+        for (Symbol author : history.authors) count += author == alice;
+        double scan = since(start);
+        benchSink += count;
+        double mbPerSecond = n * sizeof(Symbol) / (scan / 1000) / (1 << 20);
+        printf("%-10s %8zu  %8.1f  %17.2f  %11.0f\n", "columnar", n, append, scan, mbPerSecond);
+    }
+}
+
+// -------------------- Metrics --------------------
+void benchMetrics() {
+    cout << "\n=== Metrics recording (ns per call) ===\n";
+    size_t series = Metrics::instance().addSeries(Metrics::kRequest, "benchmark");
+    uint64_t ns = 1;
+    double record = timePerCall([&] { Metrics::instance().record(series, ns = ns * 7 % 1000003, 100, false); });
+    double timer = timePerCall([&] { Metrics::Timer t(series); });
+    double clock = timePerCall([] { benchSink += (size_t)chrono::steady_clock::now().time_since_epoch().count(); });
+    printf("record %6.1f    timed block %6.1f    (steady_clock::now %5.1f)\n", record, timer, clock);
+}
+
+// -------------------- Task Queue --------------------
+// Repository::tasks before TaskQueue: a std::queue, here behind a mutex
+struct LockedTaskQueue {
+    mutex lock;
+    queue<string> tasks;
+    size_t limit;
+
+    explicit LockedTaskQueue(size_t capacity) : limit(capacity) {}
+
+    bool push(string task) {
+        lock_guard<mutex> guard(lock);
+        if (tasks.size() >= limit) return false;
+        tasks.push(move(task));
+        return true;
+    }
+
+    size_t popBatch(vector<string>& out, size_t maxCount) {
+        lock_guard<mutex> guard(lock);
+        size_t n = 0;
+        for (; n < maxCount && !tasks.empty(); n++) {
+            out.push_back(move(tasks.front()));
+            tasks.pop();
+        }
+        return n;
+    }
+};
+
+// Tasks per second moved from producers to consumers; a producer that finds
+// the queue full yields and retries
+template <typename Queue>
+double taskThroughput(int producers, int consumers, size_t batch, size_t perProducer) {
+    Queue q(1024);
+    atomic<int> producing(producers);
+    atomic<size_t> consumed(0);
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&] {
+            for (size_t i = 0; i < perProducer; i++) {
+                while (!q.push("lint src/file" + to_string(i) + ".cpp")) this_thread::yield();
+            }
+            producing--;
+        });
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back([&] {
+            vector<string> claimed;
+            for (;;) {
+                claimed.clear();
+                size_t n = q.popBatch(claimed, batch);
+                if (n > 0) { consumed += n; continue; }
+                if (producing == 0 && consumed == producers * perProducer) return;
+                this_thread::yield();
+            }
+        });
+    }
+    for (thread& t : threads) t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return consumed / seconds;
+}
+
+void benchTaskQueue() {
+    cout << "\n=== Task queue (producers x consumers, tasks/s) ===\n";
+    cout << "threads  batch   mutex+queue      TaskQueue   speedup\n";
+    struct Case { int producers, consumers; size_t batch; };
+    for (Case c : {Case{1, 1, 1}, Case{4, 4, 1}, Case{4, 4, 16}, Case{8, 2, 16}}) {
+        double before = taskThroughput<LockedTaskQueue>(c.producers, c.consumers, c.batch, 200000);
+        double after = taskThroughput<TaskQueue>(c.producers, c.consumers, c.batch, 200000);
+        printf("%3d x %-3d %5zu  %12.0f   %12.0f   %7.1fx\n", c.producers, c.consumers, c.batch, before, after, after / before);
+    }
+}
+
+// -------------------- HTTP Server --------------------
+// Blocking loopback client: send a request and read back exactly one response
+// of known size
+static bool readExactly(socket_t fd, string& buffer, size_t n) {
+    char chunk[16384];
+    while (buffer.size() < n) {
+        int got = (int)recv(fd, chunk, sizeof(chunk), 0);
+        if (got <= 0) return false;
+        buffer.append(chunk, got);
+    }
+    return true;
+}
+
+static socket_t connectLoopback(int port) {
+    socket_t fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((uint16_t)port);
+    if (connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        closeSocket(fd);
+        return kInvalidSocket;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+    return fd;
+}
+
+// Requests per second through the real server into GitHub::handleRequest, with
+// several keep-alive clients each pipelining a batch of requests at a time
+void benchHttpServer() {
+    GitHub git;
+    streambuf* console = cout.rdbuf(NULL);
+    for (int i = 0; i < 200; i++) git.createRepository("repo" + to_string(i), "benchmark repository");
+    cout.rdbuf(console);
+
+    mutex apiLock;
+    HttpServer server([&](const HttpRequest& request) {
+        HttpResponse response;
+        lock_guard<mutex> guard(apiLock);
+        response.body = git.handleRequest(request.method, request.target, request.body, request.bodyLength).body;
+        return response;
+    });
+    if (!server.start(0, 4)) { cout << "\nCould not start the HTTP server\n"; return; }
+
+    const string request = "GET /api/repositories?limit=20&fields=name,description HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    socket_t probe = connectLoopback(server.port());
+    string first;
+    send(probe, request.data(), (int)request.size(), 0);
+    readExactly(probe, first, 1);
+    while (first.find("\r\n\r\n") == string::npos) readExactly(probe, first, first.size() + 1);
+    size_t bodyLength = stoul(first.substr(first.find("Content-Length: ") + 16));
+    size_t responseSize = first.find("\r\n\r\n") + 4 + bodyLength;
+    closeSocket(probe);
+
+    cout << "\n=== HTTP server (loopback, keep-alive, 4 workers) ===\n";
+    cout << "clients  pipeline     requests/s\n";
+    for (int clients : {1, 4, 16}) {
+        for (int pipeline : {1, 16}) {
+            atomic<size_t> completed(0);
+            atomic<bool> done(false);
+            vector<thread> threads;
+            string batch;
+            for (int i = 0; i < pipeline; i++) batch += request;
+            for (int c = 0; c < clients; c++) {
+                threads.emplace_back([&] {
+                    socket_t fd = connectLoopback(server.port());
+                    string buffer;
+                    while (fd != kInvalidSocket && !done) {
+                        buffer.clear();
+                        if (send(fd, batch.data(), (int)batch.size(), 0) <= 0) break;
+                        if (!readExactly(fd, buffer, responseSize * pipeline)) break;
+                        completed += pipeline;
+                    }
+                    if (fd != kInvalidSocket) closeSocket(fd);
+                });
+            }
+            auto start = chrono::steady_clock::now();
+            this_thread::sleep_for(chrono::milliseconds(1000));
+            done = true;
+            for (thread& t : threads) t.join();
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            printf("%7d  %8d  %13.0f\n", clients, pipeline, completed / seconds);
+        }
+    }
+    server.stop();
+}
+
+// -------------------- Core Operations --------------------
+// Synthetic repositories of growing size: N files, M branches besides main and
+// K edits spread over the branches (each edit is a commit). Every operation is
+// timed on each size and kept as a CoreResult for the JSON report.
+struct CoreSize { size_t files, branches, commits; };
+struct CoreResult { string operation; CoreSize size; double nsPerOp; };
+static vector<CoreResult> coreResults;
+
+static string syntheticContent(size_t file, size_t version) {
+    string content;
+    for (int line = 0; line < 12; line++) {
+        content += "// file " + to_string(file) + " line " + to_string(line) + " version " + to_string(version) + "\n";
+    }
+    if (file % 100 == 7) content += "const needle = true;\n";   // Found by the content search
+    return content;
+}
+
+static string syntheticName(size_t file) {
+    return "src/module" + to_string(file % 50) + "/file" + to_string(file) + ".cpp";
+}
+
+// Main and every branch edit their own slice of the files, so merging a branch
+// into main changes files on both sides of the merge base
+static void buildSyntheticRepo(GitHub& git, Repository* repo, const CoreSize& size) {
+    for (size_t f = 0; f < size.files; f++) git.createFile(repo, syntheticName(f), syntheticContent(f, 0));
+    for (size_t b = 0; b < size.branches; b++) git.createBranch(repo, "main", "feature" + to_string(b));
+    size_t slices = size.branches + 1;
+    for (size_t k = 0; k < size.commits; k++) {
+        size_t slice = k % slices;
+        git.switchBranch(repo, slice == 0 ? "main" : "feature" + to_string(slice - 1));
+        size_t file = (k / slices * slices + slice) % size.files;
+        git.editFile(repo, syntheticName(file), syntheticContent(file, k + 1));
+    }
+    git.switchBranch(repo, "main");
+}
+
+void benchCoreOperations() {
+    cout << "\n=== Core operations on synthetic repositories (ns per op) ===\n";
+    const CoreSize sizes[] = {{100, 4, 100}, {1000, 16, 1000}, {10000, 32, 10000}};
+    // saveToFile writes data.json to the working directory, so work in a scratch one
+    filesystem::path home = filesystem::current_path();
+    filesystem::path scratch = filesystem::temp_directory_path() / "github-sim-bench";
+    filesystem::create_directories(scratch);
+    filesystem::current_path(scratch);
+
+    for (const CoreSize& size : sizes) {
+        auto report = [&](const string& operation, double ns) {
+            coreResults.push_back(CoreResult{operation, size, ns});
+            printf("files %-6zu branches %-3zu commits %-6zu %-28s %14.1f\n", size.files, size.branches, size.commits, operation.c_str(), ns);
+        };
+        streambuf* console = cout.rdbuf(NULL);
+        GitHub git;
+        git.createRepository("bench");
+        Repository* repo = git.findRepo("bench");
+        buildSyntheticRepo(git, repo, size);
+
+        mt19937 rng(42);
+        vector<string> names;
+        for (size_t i = 0; i < 1024; i++) names.push_back(syntheticName(rng() % size.files));
+        size_t next = 0;
+        double findFile = timePerCall([&] { benchSink += git.findFile(repo, names[next++ & 1023]) != NULL; });
+        double searchNames = timePerCall([&] { benchSink += git.searchInRepository(repo, "file12").size(); });
+        double searchContent = timePerCall([&] { benchSink += git.searchInRepository(repo, "needle", true).size(); });
+
+        // The repository name index (a B+ tree) holding as many names as the repository has files
+        RepoIndex index;
+        vector<string> repoNames;
+        for (size_t i = 0; i < size.files; i++) {
+            repoNames.push_back("Project-" + to_string(rng() % 1000000) + "-" + to_string(i));
+            index.insert(repoNames.back());
+        }
+        double indexLookup = timePerCall([&] { benchSink += index.contains(repoNames[next++ % repoNames.size()]); });
+        double indexSearch = timePerCall([&] {
+            vector<string> results;
+            index.searchContaining("-42", results);
+            benchSink += results.size();
+        });
+
+        double toJSON = timePerCall([&] { benchSink += git.toJSON().size(); });
+        double saveToFile = timePerCall([&] { git.saveToFile(); });
+
+        // Mutating operations run last, each once per new branch or per merge
+        const size_t newBranches = 64;
+        auto start = chrono::steady_clock::now();
+        for (size_t b = 0; b < newBranches; b++) git.createBranch(repo, "main", "bench" + to_string(b));
+        double createBranch = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / newBranches;
+        start = chrono::steady_clock::now();
+        for (size_t b = 0; b < size.branches; b++) git.mergeBranch(repo, "feature" + to_string(b), "main");
+        double mergeBranch = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / max<size_t>(size.branches, 1);
+        cout.rdbuf(console);
+        cout.clear();
+
+        report("findFile", findFile);
+        report("searchInRepository/name", searchNames);
+        report("searchInRepository/content", searchContent);
+        report("repoIndex/contains", indexLookup);
+        report("repoIndex/searchContaining", indexSearch);
+        report("toJSON", toJSON);
+        report("saveToFile", saveToFile);
+        report("createBranch", createBranch);
+        report("mergeBranch", mergeBranch);
+    }
+    filesystem::current_path(home);
+    filesystem::remove_all(scratch);
+}
+
+// {"generated": date, "results": [{"operation", "files", "branches", "commits", "nsPerOp"}]}
+static bool writeCoreResults(const string& path) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    {
+        JsonWriter json(JsonWriter::into(file));
+        json.raw("{\"generated\":").str(formatTime(time(0))).raw(",\"results\":[");
+        for (size_t i = 0; i < coreResults.size(); i++) {
+            const CoreResult& r = coreResults[i];
+            char numbers[160];
+            snprintf(numbers, sizeof(numbers), ",\"files\":%zu,\"branches\":%zu,\"commits\":%zu,\"nsPerOp\":%.1f}",
+                     r.size.files, r.size.branches, r.size.commits, r.nsPerOp);
+            if (i > 0) json.raw(",");
+            json.raw("{\"operation\":").str(r.operation).raw(numbers);
+        }
+        json.raw("]}\n");
+    }
+    return fclose(file) == 0;
+}
+
+// Usage: benchmarks [--json FILE] [suite ...]
+// Runs the named suites (all of them by default); --json writes the core
+// operation results to FILE for comparing runs
+int main(int argc, char** argv) {
+    static const struct { const char* name; void (*run)(); } suites[] = {
+        {"search", benchTextSearch}, {"routing", benchRouting}, {"body", benchBodyParsing},
+        {"tasks", benchTaskQueue}, {"pool", benchNodePool}, {"history", benchCommitHistory},
+        {"metrics", benchMetrics}, {"http", benchHttpServer}, {"core", benchCoreOperations},
+    };
+    string jsonPath;
+    vector<string> selected;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) jsonPath = argv[++i];
+        else selected.push_back(arg);
+    }
+    cout << "GitHub simulator microbenchmarks\n";
+    for (const auto& suite : suites) {
+        if (selected.empty() || find(selected.begin(), selected.end(), suite.name) != selected.end()) suite.run();
+    }
+    if (!jsonPath.empty() && !writeCoreResults(jsonPath)) {
+        cout << "Could not write " << jsonPath << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -8,1274 +8,5595 @@
 #include <algorithm>  // For transform function
 #include <map>
 #include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string_view>
+#include <cmath>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define FD_SETSIZE 1024
+#include <winsock2.h>  // Link with -lws2_32
+#include <io.h>        // _commit
+#else
+#include <unistd.h>    // fsync
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <cerrno>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <immintrin.h>
+#define GITHUB_SIM_SSE2 1
+#if defined(__x86_64__) || defined(__i386__)
+#define GITHUB_SIM_AVX2 1
+#endif
+#endif
 using namespace std;
 
-// -------------------- Commit History --------------------
-struct Commit
-{
-    string action;
-    string user;
-    string date;
-    Commit *prev, *next;
-    Commit(string a, string u) : action(a), user(u), prev(NULL), next(NULL) 
-{
-        time_t now = time(0);
-        date = ctime(&now);
-        date.pop_back(); // remove newline
-    }
+// -------------------- Content-Addressed Blob Store --------------------
+// File contents are stored once as immutable blobs keyed by a 64-bit FNV-1a hash.
+// Every File in every branch and repository holds a reference to a shared blob, so
+// copying a file between branches is a pointer copy and identical contents are deduplicated.
+struct Blob {
+    uint64_t hash;
+    string data;
+    Blob(uint64_t h, string_view d) : hash(h), data(d) {}
 };
 
-struct CommitHistory 
-{
-    Commit* head = NULL;
-    Commit* tail = NULL;
+typedef shared_ptr<const Blob> BlobRef;
 
-    void addCommit(string action, string user) 
-{
-        Commit* c = new Commit(action, user);
-        if (!head) head = tail = c;
-        else 
-        {
-            tail->next = c;
-            c->prev = tail;
-            tail = c;
-        }
+struct BlobStore {
+    // Buckets hold every live blob with a given hash (more than one only on a collision)
+    unordered_map<uint64_t, vector<weak_ptr<const Blob>>> blobs;
+    mutex lock;     // Blobs are interned and released from merge worker threads
+
+    static BlobStore& instance() {
+        static BlobStore store;
+        return store;
     }
 
-    void showCommits()
-{
-        if (!head) { cout << "No commits yet.\n"; return; }
-        cout << "\n=== Commit History ===\n";
-        Commit* temp = head;
-        while (temp) {
-            cout << "[" << temp->date << "] " << temp->user << " - " << temp->action << endl;
-            temp = temp->next;
+    static uint64_t hashContent(string_view content) {
+        uint64_t h = 14695981039346656037ULL;
+        for (unsigned char c : content) {
+            h ^= c;
+            h *= 1099511628211ULL;
         }
+        return h;
     }
-};
-
-// -------------------- BST for Repository & File Searching --------------------
-struct BSTNode {
-    string key;
-    string content;  // For file content search
-    BSTNode *left, *right;
-    BSTNode(string k, string c = "") : key(k), content(c), left(NULL), right(NULL) {}
-};
 
-struct BST {
-    BSTNode* root = NULL;
-    
-    // Convert string to lowercase for case-insensitive search
-    string toLower(string s) {
-        transform(s.begin(), s.end(), s.begin(), ::tolower);
-        return s;
+    // Return the shared blob for this content, creating it if it is not stored yet
+    BlobRef intern(string_view content) {
+        uint64_t h = hashContent(content);
+        // Non-matching blobs we lock are dropped only after the mutex is released,
+        // since dropping the last reference re-enters release()
+        vector<BlobRef> inspected;
+        lock_guard<mutex> guard(lock);
+        vector<weak_ptr<const Blob>>& bucket = blobs[h];
+        for (const weak_ptr<const Blob>& w : bucket) {
+            BlobRef existing = w.lock();
+            if (existing && existing->data == content) return existing;
+            if (existing) inspected.push_back(existing);
+        }
+        BlobRef blob(new Blob(h, content), [](const Blob* b) { BlobStore::instance().release(b); });
+        bucket.push_back(blob);
+        return blob;
     }
-    
-    // Insert a new node with optional content
-    BSTNode* insert(BSTNode* node, string key, string content = "") {
-        if (!node) return new BSTNode(key, content);
-        if (toLower(key) < toLower(node->key)) 
-            node->left = insert(node->left, key, content);
-        else if (toLower(key) > toLower(node->key))
-            node->right = insert(node->right, key, content);
-        return node;
+
+    // Called when the last reference to a blob goes away
+    void release(const Blob* blob) {
+        lock_guard<mutex> guard(lock);
+        auto it = blobs.find(blob->hash);
+        if (it != blobs.end()) {
+            vector<weak_ptr<const Blob>>& bucket = it->second;
+            for (size_t i = 0; i < bucket.size(); i++) {
+                if (bucket[i].expired()) {
+                    bucket.erase(bucket.begin() + i);
+                    break;
+                }
+            }
+            if (bucket.empty()) blobs.erase(it);
+        }
+        delete blob;
     }
-    
-    // Exact search (case-insensitive)
-    bool search(BSTNode* node, string key) {
-        if (!node) return false;
-        if (toLower(node->key) == toLower(key)) return true;
-        if (toLower(key) < toLower(node->key)) 
-            return search(node->left, key);
-        return search(node->right, key);
+
+    size_t size() {
+        lock_guard<mutex> guard(lock);
+        return blobs.size();
     }
-    
-    // Search for nodes containing the given substring in key (case-insensitive)
-    void searchContaining(BSTNode* node, const string& term, vector<string>& results) {
-        if (!node) return;
-        
-        // Search in left subtree first
-        searchContaining(node->left, term, results);
-        
-        // Check current node
-        if (toLower(node->key).find(toLower(term)) != string::npos) {
-            results.push_back(node->key);
-        }
-        
-        // Search in right subtree
-        searchContaining(node->right, term, results);
+};
+
+// splitmix64 finalizer: spreads the bits of an FNV hash so derived values are well distributed
+inline uint64_t mixHash(uint64_t h) {
+    h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+// -------------------- Case-Insensitive Substring Search --------------------
+// ASCII case-folding substring search that works on the original bytes, without
+// copying either string. Candidate positions are found 16 (SSE2) or 32 (AVX2)
+// at a time by matching the folded first and last needle bytes; only those are
+// compared in full. AVX2 is selected at run time when the CPU supports it.
+struct TextSearch {
+    static unsigned char fold(unsigned char c) {
+        return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : c;
     }
-    
-    // Search for nodes containing the given substring in content (case-insensitive)
-    void searchInContent(BSTNode* node, const string& term, vector<string>& results) {
-        if (!node) return;
-        
-        // Search in left subtree first
-        searchInContent(node->left, term, results);
-        
-        // Check current node content if it exists
-        if (!node->content.empty() && 
-            toLower(node->content).find(toLower(term)) != string::npos) {
-            results.push_back(node->key);
+
+    static bool equalFolded(const char* a, const char* b, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            if (fold((unsigned char)a[i]) != fold((unsigned char)b[i])) return false;
         }
-        
-        // Search in right subtree
-        searchInContent(node->right, term, results);
+        return true;
     }
-    
-    // Find minimum value node
-    BSTNode* minValueNode(BSTNode* node) {
-        BSTNode* current = node;
-        while (current && current->left != NULL)
-            current = current->left;
-        return current;
+
+    // Position of the first match of needle in haystack, or string::npos
+    static size_t findIgnoreCase(const char* hay, size_t n, const char* needle, size_t m) {
+        if (m == 0) return 0;
+        if (m > n) return string::npos;
+#ifdef GITHUB_SIM_AVX2
+        static const bool useAvx2 = __builtin_cpu_supports("avx2");
+        if (useAvx2) return findAvx2(hay, n, needle, m);
+#endif
+#ifdef GITHUB_SIM_SSE2
+        return findSse2(hay, n, needle, m);
+#else
+        return findScalar(hay, n, needle, m, 0);
+#endif
     }
-    
-    // Delete a node
-    BSTNode* deleteNode(BSTNode* node, string key) {
-        if (!node) return node;
-        
-        if (toLower(key) < toLower(node->key))
-            node->left = deleteNode(node->left, key);
-        else if (toLower(key) > toLower(node->key))
-            node->right = deleteNode(node->right, key);
-        else {
-            // Node with only one child or no child
-            if (!node->left) {
-                BSTNode* temp = node->right;
-                delete node;
-                return temp;
-            }
-            else if (!node->right) {
-                BSTNode* temp = node->left;
-                delete node;
-                return temp;
-            }
-            
-            // Node with two children: Get the inorder successor
-            BSTNode* temp = minValueNode(node->right);
-            node->key = temp->key;
-            node->content = temp->content;
-            node->right = deleteNode(node->right, temp->key);
-        }
-        return node;
+
+    static size_t findIgnoreCase(const string& haystack, const string& needle) {
+        return findIgnoreCase(haystack.data(), haystack.size(), needle.data(), needle.size());
     }
-};
 
-// -------------------- Linked List for Files & Repositories --------------------
-struct File {
-    string name, content;
-    File* next;
-    File(string n, string c) : name(n), content(c), next(NULL) {}
-};
+    static bool containsIgnoreCase(const string& haystack, const string& needle) {
+        return findIgnoreCase(haystack, needle) != string::npos;
+    }
 
-// -------------------- Branch Management System --------------------
-struct Branch {
-    string branchName;
-    string parentBranch;
-    File* fileHead;
-    CommitHistory commits;
-    Branch* left;
-    Branch* right;
-    Branch* parent;
-    vector<Branch*> children;
-    
-    Branch(string name, string parent = "") : branchName(name), parentBranch(parent), 
-           fileHead(NULL), left(NULL), right(NULL), parent(NULL) {}
-    
-    // Clear all files in this branch
-    void clearFiles() {
-        while (fileHead) {
-            File* temp = fileHead;
-            fileHead = fileHead->next;
-            delete temp;
+    // Portable version, also used for the tail of the vector loops
+    static size_t findScalar(const char* hay, size_t n, const char* needle, size_t m, size_t from) {
+        unsigned char first = fold((unsigned char)needle[0]);
+        for (size_t i = from; i + m <= n; i++) {
+            if (fold((unsigned char)hay[i]) == first && equalFolded(hay + i + 1, needle + 1, m - 1)) return i;
         }
+        return string::npos;
     }
-    
-    // Deep copy files from another branch
-    void copyFilesFrom(Branch* source) {
-        if (!source) return;
-        
-        // Clear existing files first
-        clearFiles();
-        
-        File* sourceFile = source->fileHead;
-        File* prevFile = NULL;
-        
-        while (sourceFile) {
-            // Create a completely new file with copied content (deep copy)
-            File* newFile = new File(sourceFile->name, sourceFile->content);
-            
-            if (!fileHead) {
-                fileHead = newFile;
-            } else {
-                prevFile->next = newFile;
+
+private:
+#ifdef GITHUB_SIM_SSE2
+    static __m128i fold16(__m128i v) {
+        // Bytes >= 0x80 compare as negative, so only 'A'..'Z' fall in range
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                      _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+        return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    }
+
+    static size_t findSse2(const char* hay, size_t n, const char* needle, size_t m) {
+        const __m128i first = _mm_set1_epi8((char)fold((unsigned char)needle[0]));
+        const __m128i last = _mm_set1_epi8((char)fold((unsigned char)needle[m - 1]));
+        size_t i = 0;
+        for (; i + m - 1 + 16 <= n; i += 16) {
+            __m128i blockFirst = fold16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i)));
+            __m128i blockLast = fold16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i + m - 1)));
+            unsigned mask = (unsigned)_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last)));
+            while (mask) {
+                unsigned bit = (unsigned)__builtin_ctz(mask);
+                if (m <= 2 || equalFolded(hay + i + bit + 1, needle + 1, m - 2)) return i + bit;
+                mask &= mask - 1;
             }
-            prevFile = newFile;
-            sourceFile = sourceFile->next;
         }
+        return findScalar(hay, n, needle, m, i);
     }
-    
-    // Deep copy commit history from another branch
-    void copyCommitsFrom(Branch* source) {
-        if (!source) return;
-        
-        // Clear existing commits first
-        clearCommits();
-        
-        Commit* sourceCommit = source->commits.head;
-        while (sourceCommit) {
-            // Create a new commit with copied data (deep copy)
-            commits.addCommit(sourceCommit->action, sourceCommit->user);
-            sourceCommit = sourceCommit->next;
-        }
+#endif
+
+#ifdef GITHUB_SIM_AVX2
+    __attribute__((target("avx2")))
+    static __m256i fold32(__m256i v) {
+        __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+        return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
     }
-    
-    // Clear all commits in this branch
-    void clearCommits() {
-        while (commits.head) {
-            Commit* temp = commits.head;
-            commits.head = commits.head->next;
-            if (commits.head) {
-                commits.head->prev = NULL;
+
+    __attribute__((target("avx2")))
+    static size_t findAvx2(const char* hay, size_t n, const char* needle, size_t m) {
+        const __m256i first = _mm256_set1_epi8((char)fold((unsigned char)needle[0]));
+        const __m256i last = _mm256_set1_epi8((char)fold((unsigned char)needle[m - 1]));
+        size_t i = 0;
+        for (; i + m - 1 + 32 <= n; i += 32) {
+            __m256i blockFirst = fold32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i)));
+            __m256i blockLast = fold32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i + m - 1)));
+            unsigned mask = (unsigned)_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last)));
+            while (mask) {
+                unsigned bit = (unsigned)__builtin_ctz(mask);
+                if (m <= 2 || equalFolded(hay + i + bit + 1, needle + 1, m - 2)) return i + bit;
+                mask &= mask - 1;
             }
-            delete temp;
         }
-        commits.tail = NULL;
-    }
-    
-    // Destructor to clean up memory
-    ~Branch() {
-        clearFiles();
-        clearCommits();
+        return findScalar(hay, n, needle, m, i);
     }
+#endif
 };
 
-struct BranchManager {
-    Branch* root;
-    map<string, Branch*> branchMap;
-    string currentBranch;
-    
-    BranchManager() : root(NULL), currentBranch("main") {
-        // Create main branch
-        root = new Branch("main");
-        branchMap["main"] = root;
+// -------------------- Node Pool --------------------
+// Slab allocator for small nodes. Blocks are carved from 64 KB slabs in 16-byte
+// size classes, and a freed block goes on its class's free list for the next
+// node of that size. Nodes allocated together sit next to each other, and
+// destroying the pool returns whole slabs instead of one block at a time.
+// A pool takes no lock: its owner serializes every allocation and release (a
+// repository's nodes are only created and dropped under its exclusive lock).
+class NodePool {
+    struct FreeBlock { FreeBlock* next; };
+
+public:
+    static const size_t kGranularity = 16;
+    static const size_t kMaxBlock = 128;            // Larger requests go to the heap
+    static const size_t kSlabBytes = 64 << 10;
+
+private:
+    FreeBlock* freeLists[kMaxBlock / kGranularity] = {};
+    vector<char*> slabs;
+    char* cursor = NULL;
+    size_t remaining = 0;
+    // Written only by the owner, but readable from any thread for statistics
+    atomic<size_t> inUse{0}, reserved{0};
+
+    static size_t sizeClass(size_t bytes) { return (max<size_t>(bytes, 1) + kGranularity - 1) / kGranularity - 1; }
+
+public:
+    NodePool() {}
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+    ~NodePool() {
+        for (char* slab : slabs) ::operator delete(slab);
     }
-    
-    bool createBranch(string baseBranch, string newBranch) {
-        if (branchMap.find(newBranch) != branchMap.end()) {
-            return false; // Branch already exists
+
+    void* allocate(size_t bytes) {
+        if (bytes > kMaxBlock) return ::operator new(bytes);
+        size_t c = sizeClass(bytes);
+        inUse.store(inUse.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        if (FreeBlock* block = freeLists[c]) {
+            freeLists[c] = block->next;
+            return block;
         }
-        
-        Branch* base = branchMap[baseBranch];
-        if (!base) return false;
-        
-        Branch* newBr = new Branch(newBranch, baseBranch);
-        
-        // Deep copy files and commits from base branch
-        newBr->copyFilesFrom(base);
-        newBr->copyCommitsFrom(base);
-        
-        // Set up branch relationships
-        newBr->parent = base;
-        base->children.push_back(newBr);
-        branchMap[newBranch] = newBr;
-        
-        return true;
-    }
-    
-    bool switchBranch(string branchName) {
-        if (branchMap.find(branchName) == branchMap.end()) {
-            return false;
+        size_t size = (c + 1) * kGranularity;
+        if (remaining < size) {
+            cursor = static_cast<char*>(::operator new(kSlabBytes));
+            slabs.push_back(cursor);
+            remaining = kSlabBytes;
+            reserved.store(slabs.size() * kSlabBytes, memory_order_relaxed);
         }
-        currentBranch = branchName;
-        return true;
+        void* block = cursor;
+        cursor += size;
+        remaining -= size;
+        return block;
     }
-    
-    Branch* getCurrentBranch() {
-        return branchMap[currentBranch];
+
+    void deallocate(void* p, size_t bytes) {
+        if (bytes > kMaxBlock) { ::operator delete(p); return; }
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        size_t c = sizeClass(bytes);
+        block->next = freeLists[c];
+        freeLists[c] = block;
+        inUse.store(inUse.load(memory_order_relaxed) - 1, memory_order_relaxed);
     }
-    
-    vector<string> listBranches() {
-        vector<string> branches;
-        for (auto& pair : branchMap) {
-            branches.push_back(pair.first);
-        }
-        return branches;
+
+    size_t blocksInUse() const { return inUse.load(memory_order_relaxed); }
+    size_t bytesReserved() const { return reserved.load(memory_order_relaxed); }
+};
+
+// Standard allocator over a NodePool, for allocate_shared. Without a pool it
+// falls back to the heap.
+template <typename T>
+struct PoolAllocator {
+    typedef T value_type;
+    NodePool* pool;
+
+    explicit PoolAllocator(NodePool* p = NULL) : pool(p) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(pool ? pool->allocate(n * sizeof(T)) : ::operator new(n * sizeof(T)));
     }
-    
-    bool mergeBranch(string sourceBranch, string targetBranch) {
-        Branch* source = branchMap[sourceBranch];
-        Branch* target = branchMap[targetBranch];
-        
-        if (!source || !target) return false;
-        
-        cout << "Merging branch '" << sourceBranch << "' into '" << targetBranch << "'...\n";
-        
-        // Step 1: Copy files from source to target with proper isolation
-        int filesAdded = 0, filesUpdated = 0;
-        File* sourceFile = source->fileHead;
-        
-        while (sourceFile) {
-            // Check if file exists in target
-            File* targetFile = target->fileHead;
-            bool found = false;
-            
-            while (targetFile) {
-                if (targetFile->name == sourceFile->name) {
-                    // File exists, update content (deep copy)
-                    if (targetFile->content != sourceFile->content) {
-                        targetFile->content = sourceFile->content;
-                        filesUpdated++;
-                        cout << "  Updated: " << sourceFile->name << "\n";
-                    }
-                    found = true;
-                    break;
-                }
-                targetFile = targetFile->next;
-            }
-            
-            if (!found) {
-                // File doesn't exist, add it with deep copy
-                File* newFile = new File(sourceFile->name, sourceFile->content);
-                newFile->next = target->fileHead;
-                target->fileHead = newFile;
-                filesAdded++;
-                cout << "  Added: " << sourceFile->name << "\n";
-            }
-            
-            sourceFile = sourceFile->next;
-        }
-        
-        // Step 2: Copy commits from source branch to target branch
-        int commitsAdded = 0;
-        Commit* sourceCommit = source->commits.head;
-        
-        while (sourceCommit) {
-            // Check if this commit already exists in target (avoid duplicates)
-            bool commitExists = false;
-            Commit* targetCommit = target->commits.head;
-            
-            while (targetCommit) {
-                if (targetCommit->action == sourceCommit->action && 
-                    targetCommit->user == sourceCommit->user &&
-                    targetCommit->date == sourceCommit->date) {
-                    commitExists = true;
-                    break;
-                }
-                targetCommit = targetCommit->next;
-            }
-            
-            if (!commitExists) {
-                // Add commit to target branch (deep copy)
-                target->commits.addCommit(sourceCommit->action, sourceCommit->user);
-                commitsAdded++;
-            }
-            
-            sourceCommit = sourceCommit->next;
-        }
-        
-        // Step 3: Add merge commit to target branch
-        string mergeMessage = "Merged branch " + sourceBranch + " into " + targetBranch;
-        if (filesAdded > 0 || filesUpdated > 0 || commitsAdded > 0) {
-            mergeMessage += " (" + to_string(filesAdded) + " files added, " + 
-                           to_string(filesUpdated) + " files updated, " + 
-                           to_string(commitsAdded) + " commits merged)";
-        }
-        target->commits.addCommit(mergeMessage, "System");
-        
-        cout << "Merge completed: " << filesAdded << " files added, " 
-             << filesUpdated << " files updated, " << commitsAdded << " commits merged.\n";
-        
-        return true;
+    void deallocate(T* p, size_t n) {
+        if (pool) pool->deallocate(p, n * sizeof(T));
+        else ::operator delete(p);
     }
-    
-    string getBranchesJSON() {
-        stringstream json;
-        json << "{\"branches\":[";
-        bool first = true;
-        for (auto& pair : branchMap) {
-            if (!first) json << ",";
-            json << "{\"name\":\"" << pair.first 
-                 << "\",\"parent\":\"" << pair.second->parentBranch 
-                 << "\",\"current\":" << (pair.first == currentBranch ? "true" : "false") << "}";
-            first = false;
-        }
-        json << "],\"currentBranch\":\"" << currentBranch << "\"}";
-        return json.str();
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const { return pool == other.pool; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& other) const { return pool != other.pool; }
+};
+
+// -------------------- Symbol Table --------------------
+// Interns short strings that repeat across many records (author, branch and
+// repository names, operation types) as dense 32-bit
+// ids, so records store and compare an integer instead of a string.
+// Ids are never reused or freed; the table only grows with distinct names.
+class SymbolTable {
+private:
+    deque<string> names;                        // Index is the id; elements never move
+    unordered_map<string_view, uint32_t> ids;   // Keys point into names
+    mutable shared_mutex lock;                  // Commits are recorded from every request thread
+
+    SymbolTable() { intern(""); }   // The empty string is id 0
+
+public:
+    static SymbolTable& instance() {
+        static SymbolTable table;
+        return table;
     }
-    
-    // Destructor to clean up all branches
-    ~BranchManager() {
-        for (auto& pair : branchMap) {
-            delete pair.second;
+
+    uint32_t intern(string_view name) {
+        {
+            shared_lock<shared_mutex> guard(lock);
+            auto it = ids.find(name);
+            if (it != ids.end()) return it->second;
         }
-        branchMap.clear();
+        unique_lock<shared_mutex> guard(lock);
+        auto it = ids.find(name);
+        if (it != ids.end()) return it->second;
+        names.emplace_back(name);
+        uint32_t id = (uint32_t)names.size() - 1;
+        ids.emplace(names.back(), id);
+        return id;
     }
-};
 
-struct Repository {
-    string repoName;
-    string description;
-    bool isPrivate;
-    BranchManager branchManager;
-    queue<string> tasks;
-    Repository* next;
-    Repository(string n, string desc = "", bool priv = false) : repoName(n), description(desc), isPrivate(priv), next(NULL) {}
-    
-    File* getCurrentFiles() {
-        Branch* current = branchManager.getCurrentBranch();
-        return current ? current->fileHead : NULL;
+    // Look a name up without interning it, so probing with arbitrary input
+    // (a branch name from a request) does not grow the table
+    bool find(string_view name, uint32_t& id) const {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = ids.find(name);
+        if (it == ids.end()) return false;
+        id = it->second;
+        return true;
     }
-    
-    void setCurrentFiles(File* files) {
-        Branch* current = branchManager.getCurrentBranch();
-        if (current) {
-            current->fileHead = files;
-        }
+
+    // The reference stays valid after the lock is released: deque elements never move
+    const string& name(uint32_t id) const {
+        shared_lock<shared_mutex> guard(lock);
+        return names[id];
     }
-};
 
-// -------------------- Operation Struct for Undo/Redo --------------------
-struct Operation {
-    string type;       // createRepo, deleteRepo, createFile, editFile, deleteFile, addTask, removeTask
-    string repoName;
-    string fileName;
-    string content;
+    size_t size() const {
+        shared_lock<shared_mutex> guard(lock);
+        return names.size();
+    }
 };
 
-// -------------------- GitHub Simulation --------------------
-class GitHub {
+// An interned string. Copying, comparing and hashing a Symbol touch only its
+// id; it converts to the text where a string is needed.
+class Symbol {
 private:
-    Repository* head = NULL;
-    BST repoBST;
-    stack<Operation> undoStack, redoStack;
-    CommitHistory commits;
-    string currentUser = "Shiwani";
+    uint32_t id = 0;
 
 public:
-    // -------------------- Helper Functions --------------------
-    Repository* findRepo(string name) {
-        Repository* temp = head;
-        while (temp) {
-            if (temp->repoName == name) return temp;
-            temp = temp->next;
-        }
-        return NULL;
+    Symbol() {}
+    Symbol(string_view text) : id(SymbolTable::instance().intern(text)) {}
+    Symbol(const string& text) : Symbol(string_view(text)) {}
+    Symbol(const char* text) : Symbol(string_view(text)) {}
+
+    // The symbol for text only if it is already interned
+    static bool lookup(string_view text, Symbol& out) {
+        return SymbolTable::instance().find(text, out.id);
     }
 
-    File* findFile(Repository* repo, string name) {
-        File* temp = repo->getCurrentFiles();
-        while (temp) {
-            if (temp->name == name) return temp;
-            temp = temp->next;
-        }
-        return NULL;
+    const string& str() const { return SymbolTable::instance().name(id); }
+    operator const string&() const { return str(); }
+    uint32_t value() const { return id; }
+    bool empty() const { return id == 0; }
+
+    bool operator==(Symbol other) const { return id == other.id; }
+    bool operator!=(Symbol other) const { return id != other.id; }
+};
+
+namespace std {
+template <> struct hash<Symbol> {
+    size_t operator()(Symbol s) const { return s.value(); }
+};
+}
+
+inline ostream& operator<<(ostream& out, Symbol s) { return out << s.str(); }
+
+// -------------------- Commit History --------------------
+// ctime() formats into one static buffer; this is safe to call from several threads
+static string formatTime(time_t t) {
+    char buffer[32];
+#ifdef _WIN32
+    ctime_s(buffer, sizeof(buffer), &t);
+#else
+    ctime_r(&t, buffer);
+#endif
+    string date(buffer);
+    date.pop_back(); // remove newline
+    return date;
+}
+
+// Inverse of formatTime() for dates stored by older snapshots; 0 if unreadable
+static time_t parseTime(const string& date) {
+    static const char* months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char weekday[4], month[4];
+    struct tm parts = {};
+    if (sscanf(date.c_str(), "%3s %3s %d %d:%d:%d %d", weekday, month, &parts.tm_mday,
+               &parts.tm_hour, &parts.tm_min, &parts.tm_sec, &parts.tm_year) != 7) return 0;
+    const char* found = strstr(months, month);
+    if (!found || strlen(month) != 3) return 0;
+    parts.tm_mon = (int)(found - months) / 3;
+    parts.tm_year -= 1900;
+    parts.tm_isdst = -1;
+    time_t t = mktime(&parts);
+    return t == (time_t)-1 ? 0 : t;
+}
+
+// The fixed start of every commit message the simulator writes. A commit keeps
+// the index of its verb and stores only the rest of the message, which holds
+// the user's names, as text. Messages that start with none of them (from older
+// data files) keep verb 0 and their whole text.
+typedef uint8_t ActionVerb;
+static const char* const kActionVerbs[] = {
+    "",
+    "Created Repository: ", "Deleted Repository: ", "Edited Repository: ",
+    "Created File: ", "Deleted File: ", "Edited File: ",
+    "Created branch: ", "Switched to branch: ", "Merged branch ",
+    "Added Task: ", "Removed Task: ",
+    "Undo: Deleted file ", "Undo: Restored file ", "Undo: Reverted changes to ",
+    "Redo: Created file ", "Redo: Deleted file ", "Redo: Edited file ",
+};
+static const size_t kActionVerbCount = sizeof(kActionVerbs) / sizeof(kActionVerbs[0]);
+
+// No verb is the start of another, so at most one matches
+static ActionVerb actionVerbOf(string_view action) {
+    for (size_t v = 1; v < kActionVerbCount; v++) {
+        string_view verb = kActionVerbs[v];
+        if (action.compare(0, verb.size(), verb) == 0) return (ActionVerb)v;
     }
+    return 0;
+}
 
-    // -------------------- Repository Operations --------------------
-    void createRepository(string name, string description = "", bool isPrivate = false) {
-        if (repoBST.search(repoBST.root, name)) { cout << "Repository already exists!\n"; return; }
-        Repository* newRepo = new Repository(name, description, isPrivate);
-        newRepo->next = head;
-        head = newRepo;
-        repoBST.root = repoBST.insert(repoBST.root, name);
-        commits.addCommit("Created Repository: " + name + (isPrivate ? " (Private)" : " (Public)"), currentUser);
-        undoStack.push({"deleteRepo", name, "", ""});
-        cout << "Repository '" << name << "' created " << (isPrivate ? "(Private)" : "(Public)") << ".\n";
+// Global activity log, kept column by column: one array per field, appended in
+// step. A scan over one field reads a single contiguous array, authors are
+// symbols, message verbs are indices into kActionVerbs and dates are formatted
+// only when they are shown.
+struct CommitHistory 
+{
+    vector<int64_t> times;          // Seconds since the epoch
+    vector<Symbol> authors;
+    vector<ActionVerb> verbs;       // Fixed start of each action
+    vector<size_t> detailEnds;      // The rest of commit i's action ends here in details
+    string details;                 // The rest of every action, back to back
+    mutable mutex lock;             // Requests on different repositories add commits at the same time
+
+    void addCommit(string_view action, Symbol user, int64_t when) 
+{
+        ActionVerb verb = actionVerbOf(action);
+        lock_guard<mutex> guard(lock);
+        times.push_back(when);
+        authors.push_back(user);
+        verbs.push_back(verb);
+        details.append(action.substr(strlen(kActionVerbs[verb])));
+        detailEnds.push_back(details.size());
     }
 
-    void deleteRepository(string name) {
-        Repository* temp = head, *prev = NULL;
-        while (temp && temp->repoName != name) { prev = temp; temp = temp->next; }
-        if (!temp) { cout << "Repository not found.\n"; return; }
-        undoStack.push({"createRepo", temp->repoName, "", ""});
-        if (prev) prev->next = temp->next; else head = temp->next;
-        commits.addCommit("Deleted Repository: " + name, currentUser);
-        delete temp;
-        cout << "Repository deleted.\n";
+    size_t size() const {
+        lock_guard<mutex> guard(lock);
+        return times.size();
     }
 
-    void showRepositories() {
-        if (!head) { cout << "No repositories.\n"; return; }
-        Repository* temp = head;
-        cout << "\nRepositories:\n";
-        while (temp) { cout << "- " << temp->repoName << endl; temp = temp->next; }
+    // Call fn(time, author, verb, rest of the action) for every commit, oldest first
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        lock_guard<mutex> guard(lock);
+        size_t start = 0;
+        for (size_t i = 0; i < times.size(); i++) {
+            fn((time_t)times[i], authors[i], kActionVerbs[verbs[i]], string_view(details.data() + start, detailEnds[i] - start));
+            start = detailEnds[i];
+        }
+    }
+
+    void showCommits()
+{
+        if (size() == 0) { cout << "No commits yet.\n"; return; }
+        cout << "\n=== Commit History ===\n";
+        forEach([](time_t t, Symbol author, const char* verb, string_view detail) {
+            cout << "[" << formatTime(t) << "] " << author << " - " << verb << detail << endl;
+        });
+    }
+};
+
+// -------------------- B+ Tree for Repository Searching --------------------
+// Ordered, case-insensitive index of repository names. All leaves sit at the
+// same depth and are chained left to right, so exact lookups are O(log n) and
+// prefix scans are O(log n + matches). Each entry stores its case-folded key;
+// queries are folded byte by byte during comparison, so lookups never allocate.
+struct RepoIndex {
+    struct Entry {
+        string key;     // Case-folded name, the sort key
+        string name;    // Name as created
+    };
+
+    static const int kLeafMax = 32;     // Entries per leaf
+    static const int kInnerMax = 64;    // Children per inner node
+
+    struct Node {
+        bool leaf;
+        int count;      // Entries in a leaf, children in an inner node
+        explicit Node(bool isLeaf) : leaf(isLeaf), count(0) {}
+    };
+
+    struct Leaf : Node {
+        Entry entries[kLeafMax + 1];    // One spare slot while splitting
+        Leaf* next;
+        Leaf() : Node(true), next(NULL) {}
+    };
+
+    struct Inner : Node {
+        string keys[kInnerMax];         // keys[i] is the smallest key under children[i + 1]
+        Node* children[kInnerMax + 1];
+        Inner() : Node(false) {}
+    };
+
+    Node* root = NULL;
+    size_t entryCount = 0;
+
+    RepoIndex() {}
+    RepoIndex(const RepoIndex&) = delete;
+    RepoIndex& operator=(const RepoIndex&) = delete;
+    ~RepoIndex() { destroy(root); }
+
+    static string foldKey(const string& name) {
+        string key(name);
+        for (char& c : key) c = (char)TextSearch::fold((unsigned char)c);
+        return key;
+    }
+
+    // Compare a folded key with a query folded on the fly (<0, 0, >0)
+    static int compareFolded(const string& key, const char* query, size_t n) {
+        size_t common = min(key.size(), n);
+        for (size_t i = 0; i < common; i++) {
+            unsigned char a = (unsigned char)key[i], b = TextSearch::fold((unsigned char)query[i]);
+            if (a != b) return a < b ? -1 : 1;
+        }
+        return key.size() < n ? -1 : (key.size() > n ? 1 : 0);
+    }
+
+    size_t size() const { return entryCount; }
+
+    // Exact, case-insensitive lookup
+    bool contains(const string& name) const {
+        const Leaf* leaf = findLeaf(name.data(), name.size());
+        if (!leaf) return false;
+        int i = lowerBound(leaf, name.data(), name.size());
+        return i < leaf->count && compareFolded(leaf->entries[i].key, name.data(), name.size()) == 0;
+    }
+
+    // Returns false if a name equal ignoring case is already present
+    bool insert(const string& name) {
+        Entry entry{foldKey(name), name};
+        if (!root) root = new Leaf();
+        bool inserted = false;
+        string separator;
+        Node* split = insertInto(root, entry, inserted, separator);
+        if (split) {
+            Inner* top = new Inner();
+            top->children[0] = root;
+            top->children[1] = split;
+            top->keys[0] = separator;
+            top->count = 2;
+            root = top;
+        }
+        if (inserted) entryCount++;
+        return inserted;
+    }
+
+    // Remove a name (case-insensitive). Leaves are not merged when they shrink:
+    // the tree keeps equal depth everywhere and scans skip empty leaves.
+    bool erase(const string& name) {
+        Leaf* leaf = const_cast<Leaf*>(findLeaf(name.data(), name.size()));
+        if (!leaf) return false;
+        int i = lowerBound(leaf, name.data(), name.size());
+        if (i >= leaf->count || compareFolded(leaf->entries[i].key, name.data(), name.size()) != 0) return false;
+        for (int k = i; k + 1 < leaf->count; k++) leaf->entries[k] = move(leaf->entries[k + 1]);
+        leaf->count--;
+        leaf->entries[leaf->count] = Entry();
+        entryCount--;
+        return true;
+    }
+
+    // Names starting with prefix (case-insensitive), in order; limit 0 means no limit
+    void scanPrefix(const string& prefix, vector<string>& results, size_t limit = 0) const {
+        const Leaf* leaf = findLeaf(prefix.data(), prefix.size());
+        if (!leaf) return;
+        int i = lowerBound(leaf, prefix.data(), prefix.size());
+        for (; leaf; leaf = leaf->next, i = 0) {
+            for (; i < leaf->count; i++) {
+                if (!startsWithFolded(leaf->entries[i].key, prefix)) return;
+                results.push_back(leaf->entries[i].name);
+                if (limit && results.size() >= limit) return;
+            }
+        }
+    }
+
+    // Up to limit names that sort after `after` (case-insensitive), in order.
+    // An empty `after` starts from the first name; this is what paginated listings resume from.
+    void scanAfter(const string& after, vector<string>& results, size_t limit) const {
+        const Leaf* leaf = findLeaf(after.data(), after.size());
+        if (!leaf || !limit) return;
+        int i = lowerBound(leaf, after.data(), after.size());
+        for (; leaf; leaf = leaf->next, i = 0) {
+            for (; i < leaf->count; i++) {
+                if (compareFolded(leaf->entries[i].key, after.data(), after.size()) == 0) continue;
+                results.push_back(leaf->entries[i].name);
+                if (results.size() >= limit) return;
+            }
+        }
+    }
+
+    // Names containing term anywhere (case-insensitive), in order
+    void searchContaining(const string& term, vector<string>& results) const {
+        for (const Leaf* leaf = firstLeaf(); leaf; leaf = leaf->next) {
+            for (int i = 0; i < leaf->count; i++) {
+                if (TextSearch::containsIgnoreCase(leaf->entries[i].name, term)) results.push_back(leaf->entries[i].name);
+            }
+        }
+    }
+
+private:
+    static bool startsWithFolded(const string& key, const string& prefix) {
+        if (key.size() < prefix.size()) return false;
+        for (size_t i = 0; i < prefix.size(); i++) {
+            if ((unsigned char)key[i] != TextSearch::fold((unsigned char)prefix[i])) return false;
+        }
+        return true;
+    }
+
+    // First entry position in a leaf whose key is >= query
+    static int lowerBound(const Leaf* leaf, const char* query, size_t n) {
+        int lo = 0, hi = leaf->count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (compareFolded(leaf->entries[mid].key, query, n) < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    // Child of an inner node that may hold query
+    static int childFor(const Inner* inner, const char* query, size_t n) {
+        int lo = 0, hi = inner->count - 1;     // Over the separator keys
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (compareFolded(inner->keys[mid], query, n) <= 0) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    const Leaf* findLeaf(const char* query, size_t n) const {
+        const Node* node = root;
+        while (node && !node->leaf) {
+            const Inner* inner = static_cast<const Inner*>(node);
+            node = inner->children[childFor(inner, query, n)];
+        }
+        return static_cast<const Leaf*>(node);
+    }
+
+    const Leaf* firstLeaf() const {
+        const Node* node = root;
+        while (node && !node->leaf) node = static_cast<const Inner*>(node)->children[0];
+        return static_cast<const Leaf*>(node);
+    }
+
+    // Insert below node; returns a new right sibling if node had to split
+    static Node* insertInto(Node* node, Entry& entry, bool& inserted, string& separator) {
+        if (node->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            int i = lowerBound(leaf, entry.key.data(), entry.key.size());
+            if (i < leaf->count && leaf->entries[i].key == entry.key) return NULL;
+            for (int k = leaf->count; k > i; k--) leaf->entries[k] = move(leaf->entries[k - 1]);
+            leaf->entries[i] = move(entry);
+            leaf->count++;
+            inserted = true;
+            if (leaf->count <= kLeafMax) return NULL;
+
+            Leaf* right = new Leaf();
+            int keep = leaf->count / 2;
+            for (int k = keep; k < leaf->count; k++) right->entries[k - keep] = move(leaf->entries[k]);
+            right->count = leaf->count - keep;
+            leaf->count = keep;
+            right->next = leaf->next;
+            leaf->next = right;
+            separator = right->entries[0].key;
+            return right;
+        }
+
+        Inner* inner = static_cast<Inner*>(node);
+        int c = childFor(inner, entry.key.data(), entry.key.size());
+        string childSeparator;
+        Node* split = insertInto(inner->children[c], entry, inserted, childSeparator);
+        if (!split) return NULL;
+        for (int k = inner->count; k > c + 1; k--) {
+            inner->children[k] = inner->children[k - 1];
+            inner->keys[k - 1] = move(inner->keys[k - 2]);
+        }
+        inner->children[c + 1] = split;
+        inner->keys[c] = move(childSeparator);
+        inner->count++;
+        if (inner->count <= kInnerMax) return NULL;
+
+        // Split an overfull inner node; the middle key moves up
+        Inner* right = new Inner();
+        int keep = inner->count / 2;
+        for (int k = keep; k < inner->count; k++) right->children[k - keep] = inner->children[k];
+        for (int k = keep; k < inner->count - 1; k++) right->keys[k - keep] = move(inner->keys[k]);
+        right->count = inner->count - keep;
+        separator = move(inner->keys[keep - 1]);
+        inner->count = keep;
+        return right;
+    }
+
+    static void destroy(Node* node) {
+        if (!node) return;
+        if (node->leaf) {
+            delete static_cast<Leaf*>(node);
+            return;
+        }
+        Inner* inner = static_cast<Inner*>(node);
+        for (int i = 0; i < inner->count; i++) destroy(inner->children[i]);
+        delete inner;
+    }
+};
+
+// -------------------- Persistent Tree for Files --------------------
+// An immutable file entry: a name bound to a content blob
+struct File {
+    string name;
+    BlobRef blob;   // Shared, immutable content
+    File(string n, BlobRef b) : name(n), blob(b) {}
+
+    const string& content() const { return blob->data; }
+};
+
+typedef shared_ptr<const File> FileRef;
+
+// Treap node. Nodes are never modified after construction; updates copy the
+// path from the root to the changed node and share every other subtree.
+struct FileNode;
+typedef shared_ptr<const FileNode> FileNodeRef;
+
+struct FileNode {
+    FileRef file;
+    uint64_t priority;  // Derived from the name, so equal file sets have identical shapes
+    uint64_t digest;    // Merkle hash of every name and blob in this subtree
+    size_t size;        // Number of files in this subtree
+    FileNodeRef left, right;
+    FileNode(FileRef f, uint64_t p, FileNodeRef l, FileNodeRef r)
+        : file(f), priority(p),
+          digest(mixHash(p ^ f->blob->hash) ^ mixHash((l ? l->digest : 0) + 1) ^ mixHash((r ? r->digest : 0) + 2)),
+          size(1 + (l ? l->size : 0) + (r ? r->size : 0)), left(l), right(r) {}
+};
+
+// Open-addressing (linear probing) hash index from file name to the File entry
+// in a tree. Entries are immutable and shared by path-copied nodes, so the
+// pointers stay valid for as long as the file is in the tree.
+struct FileIndex {
+    struct Slot {
+        uint64_t hash;
+        const File* file;   // NULL marks an empty slot
+    };
+    vector<Slot> slots;
+    size_t count = 0;
+
+    explicit FileIndex(size_t expected) {
+        size_t capacity = 16;
+        while (capacity * 7 < expected * 10) capacity *= 2;
+        slots.assign(capacity, Slot{0, NULL});
+    }
+
+    const File* find(const string& name, uint64_t h) const {
+        size_t mask = slots.size() - 1;
+        for (size_t i = h & mask; slots[i].file; i = (i + 1) & mask) {
+            if (slots[i].hash == h && slots[i].file->name == name) return slots[i].file;
+        }
+        return NULL;
+    }
+
+    void upsert(const File* file, uint64_t h) {
+        if ((count + 1) * 10 > slots.size() * 7) grow();
+        size_t mask = slots.size() - 1;
+        size_t i = h & mask;
+        for (; slots[i].file; i = (i + 1) & mask) {
+            if (slots[i].hash == h && slots[i].file->name == file->name) {
+                slots[i].file = file;
+                return;
+            }
+        }
+        slots[i] = Slot{h, file};
+        count++;
+    }
+
+    // Backward-shift deletion keeps probe sequences intact without tombstones
+    void erase(const string& name, uint64_t h) {
+        size_t mask = slots.size() - 1;
+        size_t i = h & mask;
+        for (; slots[i].file; i = (i + 1) & mask) {
+            if (slots[i].hash == h && slots[i].file->name == name) break;
+        }
+        if (!slots[i].file) return;
+        count--;
+        size_t hole = i;
+        for (size_t j = (i + 1) & mask; slots[j].file; j = (j + 1) & mask) {
+            size_t home = slots[j].hash & mask;
+            // Move slot j into the hole unless its home lies cyclically in (hole, j]
+            if (((j - home) & mask) >= ((j - hole) & mask)) {
+                slots[hole] = slots[j];
+                hole = j;
+            }
+        }
+        slots[hole] = Slot{0, NULL};
+    }
+
+private:
+    void grow() {
+        vector<Slot> old;
+        old.swap(slots);
+        slots.assign(old.size() * 2, Slot{0, NULL});
+        size_t mask = slots.size() - 1;
+        for (const Slot& slot : old) {
+            if (!slot.file) continue;
+            size_t i = slot.hash & mask;
+            while (slots[i].file) i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+};
+
+// Inverted index from case-folded byte trigrams to the files containing them.
+// A substring query only needs to verify files that contain all of its trigrams.
+struct TrigramIndex {
+    unordered_map<uint32_t, vector<uint32_t>> postings;    // Trigram -> sorted document ids
+    unordered_map<string, uint32_t> docIds;                // File name -> document id
+    vector<string> docNames;                               // Document id -> file name ("" while the id is free)
+    vector<uint32_t> freeIds;                              // Ids of removed files, handed out again by add()
+
+    static uint32_t trigramAt(const char* p) {
+        return ((uint32_t)TextSearch::fold((unsigned char)p[0]) << 16) |
+               ((uint32_t)TextSearch::fold((unsigned char)p[1]) << 8) |
+               (uint32_t)TextSearch::fold((unsigned char)p[2]);
+    }
+
+    // Sorted, distinct trigrams of a text
+    static vector<uint32_t> extract(const string& text) {
+        vector<uint32_t> grams;
+        if (text.size() < 3) return grams;
+        grams.reserve(text.size() - 2);
+        for (size_t i = 0; i + 2 < text.size(); i++) grams.push_back(trigramAt(text.data() + i));
+        sort(grams.begin(), grams.end());
+        grams.erase(unique(grams.begin(), grams.end()), grams.end());
+        return grams;
+    }
+
+    // Reuses a removed file's id first, so files that come and go do not grow
+    // docNames or the ids in postings
+    void add(const string& name, const string& content) {
+        uint32_t doc;
+        if (freeIds.empty()) {
+            doc = (uint32_t)docNames.size();
+            docNames.push_back(name);
+        } else {
+            doc = freeIds.back();
+            freeIds.pop_back();
+            docNames[doc] = name;
+        }
+        docIds[name] = doc;
+        for (uint32_t g : extract(content)) link(g, doc);
+    }
+
+    void remove(const string& name, const string& content) {
+        auto it = docIds.find(name);
+        if (it == docIds.end()) return;
+        uint32_t doc = it->second;
+        for (uint32_t g : extract(content)) unlink(g, doc);
+        docNames[doc].clear();
+        docIds.erase(it);
+        freeIds.push_back(doc);
+    }
+
+    // Re-index an edited file, touching only trigrams that appeared or disappeared
+    void update(const string& name, const string& oldContent, const string& newContent) {
+        auto it = docIds.find(name);
+        if (it == docIds.end()) { add(name, newContent); return; }
+        uint32_t doc = it->second;
+        vector<uint32_t> before = extract(oldContent), after = extract(newContent);
+        vector<uint32_t> gone, added;
+        set_difference(before.begin(), before.end(), after.begin(), after.end(), back_inserter(gone));
+        set_difference(after.begin(), after.end(), before.begin(), before.end(), back_inserter(added));
+        for (uint32_t g : gone) unlink(g, doc);
+        for (uint32_t g : added) link(g, doc);
+    }
+
+    // Names of files containing every trigram of term (term must be 3+ bytes)
+    vector<string> candidates(const string& term) const {
+        vector<const vector<uint32_t>*> lists;
+        for (uint32_t g : extract(term)) {
+            auto it = postings.find(g);
+            if (it == postings.end()) return vector<string>();
+            lists.push_back(&it->second);
+        }
+        // Intersect starting from the rarest trigram
+        sort(lists.begin(), lists.end(), [](const vector<uint32_t>* a, const vector<uint32_t>* b) { return a->size() < b->size(); });
+        vector<uint32_t> docs = *lists[0];
+        for (size_t i = 1; i < lists.size() && !docs.empty(); i++) {
+            vector<uint32_t> next;
+            set_intersection(docs.begin(), docs.end(), lists[i]->begin(), lists[i]->end(), back_inserter(next));
+            docs.swap(next);
+        }
+        vector<string> names;
+        for (uint32_t doc : docs) names.push_back(docNames[doc]);
+        return names;
+    }
+
+private:
+    void link(uint32_t gram, uint32_t doc) {
+        vector<uint32_t>& list = postings[gram];
+        // A new id is the largest so far and goes at the end; a reused one is inserted in order
+        if (list.empty() || list.back() < doc) list.push_back(doc);
+        else list.insert(lower_bound(list.begin(), list.end(), doc), doc);
+    }
+
+    void unlink(uint32_t gram, uint32_t doc) {
+        auto it = postings.find(gram);
+        if (it == postings.end()) return;
+        vector<uint32_t>& list = it->second;
+        auto pos = lower_bound(list.begin(), list.end(), doc);
+        if (pos != list.end() && *pos == doc) list.erase(pos);
+        if (list.empty()) postings.erase(it);
+    }
+};
+
+// A branch's set of files, ordered by name. Copying a FileTree is O(1) and the
+// copies are fully isolated; put/erase cost O(log n) node copies.
+// Lookups go through a hash index, and content searches through a trigram index;
+// both are built on first use and then kept in sync by put/erase. Copies start
+// without indexes so sharing a tree stays O(1).
+struct FileTree {
+    FileNodeRef root;
+    mutable unique_ptr<FileIndex> index;
+    mutable unique_ptr<TrigramIndex> trigrams;
+    NodePool* pool = NULL;      // The owning repository's nodes; NULL allocates from the heap
+
+    // Trees smaller than this are searched directly
+    static const size_t kIndexThreshold = 32;
+
+    FileTree() {}
+    FileTree(const FileTree& other) : root(other.root), pool(other.pool) {}
+    FileTree(FileTree&& other) = default;
+    FileTree& operator=(const FileTree& other) {
+        if (this != &other) {
+            root = other.root;
+            pool = other.pool;
+            index.reset();
+            trigrams.reset();
+        }
+        return *this;
+    }
+    FileTree& operator=(FileTree&& other) = default;
+
+    static uint64_t priorityOf(const string& name) {
+        return mixHash(BlobStore::hashContent(name));
+    }
+
+    static FileRef makeFile(NodePool* pool, const string& name, BlobRef blob) {
+        return allocate_shared<const File>(PoolAllocator<File>(pool), name, blob);
+    }
+
+    static FileNodeRef makeNode(NodePool* pool, FileRef file, uint64_t p, FileNodeRef left, FileNodeRef right) {
+        return allocate_shared<const FileNode>(PoolAllocator<FileNode>(pool), file, p, left, right);
+    }
+
+    size_t size() const { return root ? root->size : 0; }
+    uint64_t digest() const { return root ? root->digest : 0; }
+
+    // Build the lookup index now so that concurrent readers never build it
+    void warmIndex() const {
+        if (size() >= kIndexThreshold && !index) buildIndex();
+    }
+    bool empty() const { return !root; }
+
+    // True when content search will not build anything, so it can run under a shared lock
+    bool searchReady() const {
+        return trigrams && (size() < kIndexThreshold || index);
+    }
+
+    const File* find(const string& name) const {
+        if (size() >= kIndexThreshold) {
+            if (!index) buildIndex();
+            return index->find(name, priorityOf(name));
+        }
+        const FileNode* node = root.get();
+        while (node) {
+            int cmp = name.compare(node->file->name);
+            if (cmp == 0) return node->file.get();
+            node = cmp < 0 ? node->left.get() : node->right.get();
+        }
+        return NULL;
+    }
+
+    // Insert a file or replace the blob of an existing one
+    void put(const string& name, BlobRef blob) {
+        uint64_t p = priorityOf(name);
+        FileRef file = makeFile(pool, name, blob);
+        if (trigrams) {
+            const File* old = find(name);
+            if (old) trigrams->update(name, old->content(), blob->data);
+            else trigrams->add(name, blob->data);
+        }
+        // Update the index first: the replaced entry may be freed by the insert
+        if (index) index->upsert(file.get(), p);
+        root = insert(root, file, p);
+    }
+
+    void put(const string& name, const string& content) {
+        put(name, BlobStore::instance().intern(content));
+    }
+
+    bool erase(const string& name) {
+        const File* existing = find(name);
+        if (!existing) return false;
+        if (trigrams) trigrams->remove(name, existing->content());
+        if (index) index->erase(name, priorityOf(name));
+        root = remove(root, name);
+        return true;
+    }
+
+    void clear() {
+        root.reset();
+        index.reset();
+        trigrams.reset();
+    }
+
+    // Trigram index over file contents, built on first use
+    const TrigramIndex& contentIndex() const {
+        if (!trigrams) {
+            trigrams.reset(new TrigramIndex());
+            forEach([this](const File& f) { trigrams->add(f.name, f.content()); });
+        }
+        return *trigrams;
+    }
+
+    // In-order (alphabetical) traversal
+    template <typename Visitor>
+    void forEach(Visitor visit) const { walk(root.get(), visit); }
+
+private:
+    void buildIndex() const {
+        index.reset(new FileIndex(size()));
+        forEach([this](const File& f) { index->upsert(&f, priorityOf(f.name)); });
+    }
+
+    template <typename Visitor>
+    static void walk(const FileNode* node, Visitor& visit) {
+        while (node) {
+            walk(node->left.get(), visit);
+            visit(*node->file);
+            node = node->right.get();
+        }
+    }
+
+    static bool outranks(uint64_t p, const string& name, const FileNode* node) {
+        return p > node->priority || (p == node->priority && name < node->file->name);
+    }
+
+    FileNodeRef insert(const FileNodeRef& node, const FileRef& file, uint64_t p) const {
+        if (!node) return makeNode(pool, file, p, nullptr, nullptr);
+        int cmp = file->name.compare(node->file->name);
+        if (cmp == 0) return makeNode(pool, file, node->priority, node->left, node->right);
+        if (cmp < 0) {
+            FileNodeRef l = insert(node->left, file, p);
+            if (l->file == file && outranks(p, file->name, node.get())) {
+                // Rotate right: the new node becomes the subtree root
+                return makeNode(pool, l->file, l->priority, l->left,
+                    makeNode(pool, node->file, node->priority, l->right, node->right));
+            }
+            return makeNode(pool, node->file, node->priority, l, node->right);
+        }
+        FileNodeRef r = insert(node->right, file, p);
+        if (r->file == file && outranks(p, file->name, node.get())) {
+            // Rotate left
+            return makeNode(pool, r->file, r->priority,
+                makeNode(pool, node->file, node->priority, node->left, r->left), r->right);
+        }
+        return makeNode(pool, node->file, node->priority, node->left, r);
+    }
+
+    FileNodeRef join(const FileNodeRef& a, const FileNodeRef& b) const {
+        if (!a) return b;
+        if (!b) return a;
+        if (!outranks(b->priority, b->file->name, a.get()))
+            return makeNode(pool, a->file, a->priority, a->left, join(a->right, b));
+        return makeNode(pool, b->file, b->priority, join(a, b->left), b->right);
+    }
+
+    FileNodeRef remove(const FileNodeRef& node, const string& name) const {
+        int cmp = name.compare(node->file->name);
+        if (cmp == 0) return join(node->left, node->right);
+        if (cmp < 0) return makeNode(pool, node->file, node->priority, remove(node->left, name), node->right);
+        return makeNode(pool, node->file, node->priority, node->left, remove(node->right, name));
+    }
+};
+
+// -------------------- Commit Graph --------------------
+// A commit in the repository's history DAG. The file tree is a persistent
+// snapshot, so recording it costs one pointer copy.
+struct CommitNode {
+    uint64_t hash;          // Covers parents, tree digest, message, author and date
+    vector<int> parents;    // Indices into CommitGraph::commits
+    ActionVerb verb;        // Fixed start of the message (see kActionVerbs)
+    string detail;          // The rest of the message
+    Symbol author;
+    int64_t timestamp;      // Seconds since the epoch
+    FileTree tree;
+
+    string action() const { return kActionVerbs[verb] + detail; }
+    string date() const { return formatTime((time_t)timestamp); }
+
+    string id() const {
+        static const char* digits = "0123456789abcdef";
+        string hex(16, '0');
+        for (int i = 15; i >= 0; i--) hex[15 - i] = digits[(hash >> (i * 4)) & 0xf];
+        return hex;
+    }
+};
+
+// One commit graph per repository; branches are refs into it. Commits are only
+// ever appended, so a commit's index is a topological order (parents come first).
+struct CommitGraph {
+    vector<CommitNode> commits;
+    unordered_map<uint64_t, int> byHash;
+
+    // when is part of the hash, so replaying a logged mutation with its
+    // original time rebuilds the same commit
+    int addCommit(const vector<int>& parents, string action, Symbol user, const FileTree& tree, int64_t when) {
+        uint64_t h = BlobStore::hashContent(action + '\n' + user.str() + '\n' + to_string(when));
+        h = mixHash(h ^ tree.digest());
+        for (int p : parents) h = mixHash(h ^ commits[p].hash);
+
+        auto existing = byHash.find(h);
+        if (existing != byHash.end()) return existing->second;
+
+        ActionVerb verb = actionVerbOf(action);
+        commits.push_back(CommitNode{h, parents, verb, action.substr(strlen(kActionVerbs[verb])), user, when, tree});
+        int index = (int)commits.size() - 1;
+        byHash[h] = index;
+        return index;
+    }
+
+    // Mark every commit reachable from head (including head itself)
+    vector<char> reachable(int head) const {
+        vector<char> seen(commits.size(), 0);
+        if (head < 0) return seen;
+        vector<int> pending(1, head);
+        seen[head] = 1;
+        while (!pending.empty()) {
+            int c = pending.back();
+            pending.pop_back();
+            for (int p : commits[c].parents) {
+                if (!seen[p]) { seen[p] = 1; pending.push_back(p); }
+            }
+        }
+        return seen;
+    }
+
+    // Commits reachable from head in the order they were made
+    vector<int> history(int head) const {
+        vector<int> result;
+        vector<char> seen = reachable(head);
+        for (size_t i = 0; i < seen.size(); i++) {
+            if (seen[i]) result.push_back((int)i);
+        }
+        return result;
+    }
+
+    // Best common ancestor of two commits, or -1 if they share no history.
+    // Walks both sides from the highest index down; the first commit reached
+    // from both sides is a common ancestor that no other common ancestor follows.
+    int mergeBase(int a, int b) const {
+        if (a < 0 || b < 0) return -1;
+        if (a == b) return a;
+        const char FROM_A = 1, FROM_B = 2;
+        unordered_map<int, char> flags;
+        priority_queue<int> frontier;
+        flags[a] |= FROM_A; frontier.push(a);
+        flags[b] |= FROM_B; frontier.push(b);
+        while (!frontier.empty()) {
+            int c = frontier.top();
+            frontier.pop();
+            while (!frontier.empty() && frontier.top() == c) frontier.pop();
+            char f = flags[c];
+            if (f == (FROM_A | FROM_B)) return c;
+            for (int p : commits[c].parents) {
+                char& pf = flags[p];
+                if ((pf | f) != pf) {
+                    pf |= f;
+                    frontier.push(p);
+                }
+            }
+        }
+        return -1;
+    }
+
+    const CommitNode* get(int index) const {
+        return index >= 0 && index < (int)commits.size() ? &commits[index] : NULL;
+    }
+};
+
+// -------------------- Work-Stealing Thread Pool --------------------
+// Each worker owns a deque: it pops its own newest task and, when empty, steals the
+// oldest task from another worker. A thread waiting in parallelFor runs tasks too,
+// so nested calls cannot deadlock.
+class WorkStealingPool {
+    struct WorkQueue {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<WorkQueue>> queues;
+    vector<thread> workers;
+    mutex sleepLock;
+    condition_variable wake;
+    atomic<size_t> queued;
+    atomic<size_t> nextQueue;
+    bool stopping;
+
+public:
+    explicit WorkStealingPool(size_t threadCount) : queued(0), nextQueue(0), stopping(false) {
+        if (threadCount == 0) threadCount = 1;
+        for (size_t i = 0; i < threadCount; i++) queues.emplace_back(new WorkQueue());
+        for (size_t i = 0; i < threadCount; i++) workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> guard(sleepLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& t : workers) t.join();
+    }
+
+    // Shared pool sized to the machine
+    static WorkStealingPool& instance() {
+        static WorkStealingPool pool(thread::hardware_concurrency());
+        return pool;
+    }
+
+    size_t threadCount() const { return workers.size(); }
+
+    // Run body(i) for every i in [0, count) and wait for all of them.
+    // Small ranges run inline on the calling thread.
+    template <typename Body>
+    void parallelFor(size_t count, Body body, size_t grain = 64) {
+        if (count == 0) return;
+        if (count <= grain || workers.empty()) {
+            for (size_t i = 0; i < count; i++) body(i);
+            return;
+        }
+        size_t chunks = min((count + grain - 1) / grain, workers.size() * 4);
+        size_t chunkSize = (count + chunks - 1) / chunks;
+        atomic<size_t> remaining(0);
+        for (size_t begin = 0; begin < count; begin += chunkSize) {
+            size_t end = min(count, begin + chunkSize);
+            remaining++;
+            push([&body, &remaining, begin, end] {
+                for (size_t i = begin; i < end; i++) body(i);
+                remaining--;
+            });
+        }
+        {
+            // A worker that saw no work is either waiting now or will see the new tasks
+            lock_guard<mutex> guard(sleepLock);
+        }
+        wake.notify_all();
+        while (remaining > 0) {
+            if (!runOne(nextQueue++ % queues.size())) this_thread::yield();
+        }
+    }
+
+private:
+    void push(function<void()> task) {
+        WorkQueue& q = *queues[nextQueue++ % queues.size()];
+        {
+            lock_guard<mutex> guard(q.lock);
+            q.tasks.push_back(move(task));
+        }
+        queued++;
+    }
+
+    // Pop from our own queue, otherwise steal; returns false if nothing was found
+    bool runOne(size_t self) {
+        function<void()> task;
+        for (size_t k = 0; k < queues.size() && !task; k++) {
+            WorkQueue& q = *queues[(self + k) % queues.size()];
+            lock_guard<mutex> guard(q.lock);
+            if (q.tasks.empty()) continue;
+            if (k == 0) { task = move(q.tasks.back()); q.tasks.pop_back(); }
+            else { task = move(q.tasks.front()); q.tasks.pop_front(); }
+        }
+        if (!task) return false;
+        queued--;
+        task();
+        return true;
+    }
+
+    void workerLoop(size_t self) {
+        for (;;) {
+            if (runOne(self)) continue;
+            unique_lock<mutex> guard(sleepLock);
+            wake.wait(guard, [this] { return stopping || queued > 0; });
+            if (stopping) return;
+        }
+    }
+};
+
+// -------------------- Task Queue --------------------
+// Bounded multi-producer, multi-consumer queue (Vyukov's ring buffer). Each slot
+// has a sequence number saying whose turn it is: ticket t may fill the slot when
+// it reads t and empty it when it reads t + 1. Producers and consumers only race
+// on one compare-and-swap of the tail or head, so nobody waits on a lock. A full
+// queue refuses a push instead of growing, which is the backpressure signal.
+class TaskQueue {
+    struct Slot {
+        atomic<size_t> sequence;
+        string task;
+        int64_t queuedAt = 0;     // Steady clock, in nanoseconds; set on sampled tickets only
+    };
+
+    unique_ptr<Slot[]> slots;
+    size_t mask;
+    // Tickets only grow, so they double as the pushed and popped totals
+    alignas(64) atomic<size_t> tail;    // Next ticket for a producer
+    alignas(64) atomic<size_t> head;    // Next ticket for a consumer
+    alignas(64) atomic<uint64_t> rejected;
+    atomic<uint64_t> totalWait, maxWait, sampled;
+    int64_t created;
+
+    static int64_t now() {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Reading the clock costs as much as the rest of a push, so only one ticket
+    // in kWaitSample is timed; the wait statistics come from that sample
+    static const size_t kWaitSample = 16;
+    static bool timed(size_t ticket) { return (ticket & (kWaitSample - 1)) == 0; }
+
+    // Add one claim's sampled waits: how many, their sum and the longest
+    void recordWait(uint64_t count, uint64_t total, uint64_t longest) {
+        sampled.fetch_add(count, memory_order_relaxed);
+        totalWait.fetch_add(total, memory_order_relaxed);
+        uint64_t current = maxWait.load(memory_order_relaxed);
+        while (longest > current && !maxWait.compare_exchange_weak(current, longest, memory_order_relaxed)) {}
+    }
+
+public:
+    static const size_t kDefaultCapacity = 1024;
+
+    struct Stats {
+        size_t depth, capacity;
+        uint64_t enqueued, dequeued, rejected;
+        double enqueueRate, dequeueRate;    // Per second since the queue was created
+        double averageWaitMs, maxWaitMs;    // Time from push to pop, over the timed tasks
+    };
+
+    // The capacity is rounded up to a power of two
+    explicit TaskQueue(size_t capacity = kDefaultCapacity)
+        : tail(0), head(0), rejected(0), totalWait(0), maxWait(0), sampled(0), created(now()) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        slots.reset(new Slot[size]);
+        for (size_t i = 0; i < size; i++) slots[i].sequence.store(i, memory_order_relaxed);
+        mask = size - 1;
+    }
+    TaskQueue(const TaskQueue&) = delete;
+    TaskQueue& operator=(const TaskQueue&) = delete;
+
+    // Returns false, and counts a rejection, if the queue is full
+    bool push(string task) {
+        size_t ticket = tail.load(memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[ticket & mask];
+            intptr_t diff = (intptr_t)(slot.sequence.load(memory_order_acquire) - ticket);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(ticket, ticket + 1, memory_order_relaxed)) {
+                    slot.task = move(task);
+                    if (timed(ticket)) slot.queuedAt = now();
+                    slot.sequence.store(ticket + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // The slot still holds the task from one lap behind
+                rejected.fetch_add(1, memory_order_relaxed);
+                return false;
+            } else {
+                ticket = tail.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(string& task) {
+        vector<string> one;
+        if (popBatch(one, 1) == 0) return false;
+        task = move(one[0]);
+        return true;
+    }
+
+    // Take up to maxCount tasks from the front, in order, with a single
+    // compare-and-swap on the head. Returns how many were appended to out.
+    size_t popBatch(vector<string>& out, size_t maxCount) {
+        maxCount = min(maxCount, mask + 1);
+        if (maxCount == 0) return 0;
+        size_t ticket = head.load(memory_order_relaxed);
+        for (;;) {
+            // Count the filled slots at the head; they stay filled until consumed
+            size_t ready = 0;
+            while (ready < maxCount && slots[(ticket + ready) & mask].sequence.load(memory_order_acquire) == ticket + ready + 1) ready++;
+            if (ready == 0) {
+                intptr_t diff = (intptr_t)(slots[ticket & mask].sequence.load(memory_order_acquire) - (ticket + 1));
+                if (diff < 0) return 0;     // Empty, or the next push has not finished
+                ticket = head.load(memory_order_relaxed);
+                continue;
+            }
+            if (head.compare_exchange_weak(ticket, ticket + ready, memory_order_relaxed)) {
+                int64_t time = 0;
+                uint64_t count = 0, total = 0, longest = 0;
+                for (size_t i = 0; i < ready; i++) {
+                    // Take the task, then hand the slot to the producer one lap ahead
+                    Slot& slot = slots[(ticket + i) & mask];
+                    if (timed(ticket + i)) {
+                        if (count++ == 0) time = now();
+                        uint64_t waited = (uint64_t)max<int64_t>(0, time - slot.queuedAt);
+                        total += waited;
+                        longest = max(longest, waited);
+                    }
+                    out.push_back(move(slot.task));
+                    slot.task.clear();
+                    slot.sequence.store(ticket + i + mask + 1, memory_order_release);
+                }
+                if (count > 0) recordWait(count, total, longest);
+                return ready;
+            }
+        }
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    // Approximate while other threads push or pop
+    size_t size() const {
+        size_t h = head.load(memory_order_acquire);
+        size_t t = tail.load(memory_order_acquire);
+        return t > h ? min(t - h, mask + 1) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // Tasks in queue order. Only valid while no other thread pushes or pops:
+    // from the console, or under the repository's exclusive lock.
+    vector<string> pending() const {
+        vector<string> tasks;
+        size_t t = tail.load(memory_order_acquire);
+        for (size_t i = head.load(memory_order_acquire); i < t; i++) tasks.push_back(slots[i & mask].task);
+        return tasks;
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.depth = size();
+        s.capacity = capacity();
+        s.enqueued = tail.load(memory_order_relaxed);
+        s.dequeued = head.load(memory_order_relaxed);
+        s.rejected = rejected.load(memory_order_relaxed);
+        double seconds = max(1e-9, (now() - created) / 1e9);
+        s.enqueueRate = s.enqueued / seconds;
+        s.dequeueRate = s.dequeued / seconds;
+        uint64_t samples = sampled.load(memory_order_relaxed);
+        s.averageWaitMs = samples ? totalWait.load(memory_order_relaxed) / 1e6 / samples : 0;
+        s.maxWaitMs = maxWait.load(memory_order_relaxed) / 1e6;
+        return s;
+    }
+};
+
+// -------------------- Arena Allocator --------------------
+// Bump allocator for short-lived, trivially destructible buffers. reset() rewinds
+// without returning memory, so repeated diffs reuse the same blocks.
+struct Arena {
+    vector<pair<char*, size_t>> blocks;
+    size_t current = 0;     // Block being allocated from
+    size_t used = 0;        // Bytes used in the current block
+    static const size_t kBlockSize = 1 << 20;
+
+    Arena() {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t bytes, size_t align) {
+        while (current < blocks.size()) {
+            size_t start = (used + align - 1) & ~(align - 1);
+            if (start + bytes <= blocks[current].second) {
+                used = start + bytes;
+                return blocks[current].first + start;
+            }
+            current++;
+            used = 0;
+        }
+        size_t size = max(bytes + align, (size_t)kBlockSize);
+        blocks.push_back(make_pair(static_cast<char*>(::operator new(size)), size));
+        current = blocks.size() - 1;
+        size_t start = (reinterpret_cast<uintptr_t>(blocks[current].first) + align - 1) & ~(uintptr_t)(align - 1);
+        start -= reinterpret_cast<uintptr_t>(blocks[current].first);
+        used = start + bytes;
+        return blocks[current].first + start;
+    }
+
+    template <typename T>
+    T* allocArray(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void reset() {
+        current = 0;
+        used = 0;
+    }
+
+    ~Arena() {
+        for (auto& block : blocks) ::operator delete(block.first);
+    }
+};
+
+// -------------------- Line Diff & Three-Way Merge --------------------
+// A line of a blob, including its trailing newline. Points into the blob's data.
+struct LineSpan {
+    const char* ptr;
+    size_t len;
+    uint64_t hash;
+
+    bool operator==(const LineSpan& other) const {
+        return hash == other.hash && len == other.len && memcmp(ptr, other.ptr, len) == 0;
+    }
+};
+
+// A changed region: base lines [baseStart, baseEnd) became side lines [sideStart, sideEnd)
+struct DiffHunk {
+    size_t baseStart, baseEnd;
+    size_t sideStart, sideEnd;
+};
+
+struct LineDiff {
+    // Split text into lines allocated from the arena; returns the line count
+    static size_t splitLines(const string& text, Arena& arena, LineSpan*& lines) {
+        size_t count = 0;
+        for (char c : text) if (c == '\n') count++;
+        if (!text.empty() && text.back() != '\n') count++;
+        lines = arena.allocArray<LineSpan>(count + 1);
+        size_t n = 0, start = 0;
+        for (size_t i = 0; i <= text.size(); i++) {
+            if (i == text.size() ? start < i : text[i] == '\n') {
+                size_t end = i == text.size() ? i : i + 1;
+                uint64_t h = 14695981039346656037ULL;
+                for (size_t k = start; k < end; k++) {
+                    h ^= (unsigned char)text[k];
+                    h *= 1099511628211ULL;
+                }
+                lines[n++] = LineSpan{text.data() + start, end - start, h};
+                start = end;
+            }
+        }
+        return n;
+    }
+
+    // Myers' O(ND) diff in linear space (divide and conquer on the middle snake).
+    // Returns the hunks that turn a[0..n) into b[0..m), in order.
+    static vector<DiffHunk> diff(const LineSpan* a, size_t n, const LineSpan* b, size_t m, Arena& arena) {
+        Search search;
+        search.a = a;
+        search.b = b;
+        search.changedA = arena.allocArray<char>(n + 1);
+        search.changedB = arena.allocArray<char>(m + 1);
+        memset(search.changedA, 0, n + 1);
+        memset(search.changedB, 0, m + 1);
+        long diagonals = (long)n + (long)m + 3;
+        search.fd = arena.allocArray<long>(diagonals) + m + 1;
+        search.bd = arena.allocArray<long>(diagonals) + m + 1;
+        search.compare(0, (long)n, 0, (long)m);
+
+        vector<DiffHunk> hunks;
+        size_t i = 0, j = 0;
+        while (i < n || j < m) {
+            if ((i < n && search.changedA[i]) || (j < m && search.changedB[j])) {
+                DiffHunk h{i, i, j, j};
+                while (i < n && search.changedA[i]) i++;
+                while (j < m && search.changedB[j]) j++;
+                h.baseEnd = i;
+                h.sideEnd = j;
+                hunks.push_back(h);
+            } else {
+                i++;
+                j++;
+            }
+        }
+        return hunks;
+    }
+
+private:
+    struct Search {
+        const LineSpan* a;
+        const LineSpan* b;
+        char* changedA;
+        char* changedB;
+        long* fd;   // Furthest forward x on each diagonal (indexed by x - y)
+        long* bd;   // Furthest backward x on each diagonal
+
+        void compare(long xoff, long xlim, long yoff, long ylim) {
+            while (xoff < xlim && yoff < ylim && a[xoff] == b[yoff]) { xoff++; yoff++; }
+            while (xlim > xoff && ylim > yoff && a[xlim - 1] == b[ylim - 1]) { xlim--; ylim--; }
+            if (xoff == xlim) {
+                while (yoff < ylim) changedB[yoff++] = 1;
+            } else if (yoff == ylim) {
+                while (xoff < xlim) changedA[xoff++] = 1;
+            } else {
+                long xmid, ymid;
+                middleSnake(xoff, xlim, yoff, ylim, xmid, ymid);
+                compare(xoff, xmid, yoff, ymid);
+                compare(xmid, xlim, ymid, ylim);
+            }
+        }
+
+        // Find a point on an optimal path that splits the problem in two
+        void middleSnake(long xoff, long xlim, long yoff, long ylim, long& xmid, long& ymid) {
+            const long dmin = xoff - ylim, dmax = xlim - yoff;
+            const long fmid = xoff - yoff, bmid = xlim - ylim;
+            long fmin = fmid, fmax = fmid, bmin = bmid, bmax = bmid;
+            const bool odd = (fmid - bmid) & 1;
+            fd[fmid] = xoff;
+            bd[bmid] = xlim;
+            for (;;) {
+                if (fmin > dmin) fd[--fmin - 1] = -1; else ++fmin;
+                if (fmax < dmax) fd[++fmax + 1] = -1; else --fmax;
+                for (long d = fmax; d >= fmin; d -= 2) {
+                    long tlo = fd[d - 1], thi = fd[d + 1];
+                    long x = tlo >= thi ? tlo + 1 : thi;
+                    long y = x - d;
+                    while (x < xlim && y < ylim && a[x] == b[y]) { x++; y++; }
+                    fd[d] = x;
+                    if (odd && bmin <= d && d <= bmax && bd[d] <= x) {
+                        xmid = x; ymid = y;
+                        return;
+                    }
+                }
+                if (bmin > dmin) bd[--bmin - 1] = LONG_MAX; else ++bmin;
+                if (bmax < dmax) bd[++bmax + 1] = LONG_MAX; else --bmax;
+                for (long d = bmax; d >= bmin; d -= 2) {
+                    long tlo = bd[d - 1], thi = bd[d + 1];
+                    long x = tlo < thi ? tlo : thi - 1;
+                    long y = x - d;
+                    while (x > xoff && y > yoff && a[x - 1] == b[y - 1]) { x--; y--; }
+                    bd[d] = x;
+                    if (!odd && fmin <= d && d <= fmax && x <= fd[d]) {
+                        xmid = x; ymid = y;
+                        return;
+                    }
+                }
+            }
+        }
+    };
+};
+
+// diff3-style merge of two descendants of a common base text
+struct ThreeWayMerge {
+    // Merge 'ours' and 'theirs' against 'base' into 'result'. Non-overlapping hunks
+    // are applied automatically; overlapping, different hunks are written with
+    // conflict markers. Returns the number of conflicting regions.
+    static int mergeText(const string& base, const string& ours, const string& theirs,
+                         const string& oursLabel, const string& theirsLabel,
+                         string& result, Arena& arena) {
+        LineSpan *baseLines, *ourLines, *theirLines;
+        size_t nBase = LineDiff::splitLines(base, arena, baseLines);
+        size_t nOurs = LineDiff::splitLines(ours, arena, ourLines);
+        size_t nTheirs = LineDiff::splitLines(theirs, arena, theirLines);
+        vector<DiffHunk> ourHunks = LineDiff::diff(baseLines, nBase, ourLines, nOurs, arena);
+        vector<DiffHunk> theirHunks = LineDiff::diff(baseLines, nBase, theirLines, nTheirs, arena);
+
+        result.clear();
+        result.reserve(max(ours.size(), theirs.size()));
+        int conflicts = 0;
+        size_t basePos = 0;                 // Next base line not yet emitted
+        long ourDelta = 0, theirDelta = 0;  // Side line index minus base line index so far
+        size_t i = 0, j = 0;
+        while (i < ourHunks.size() || j < theirHunks.size()) {
+            // Start a region at the earliest hunk and absorb every hunk touching it
+            size_t lo;
+            if (j == theirHunks.size()) lo = ourHunks[i].baseStart;
+            else if (i == ourHunks.size()) lo = theirHunks[j].baseStart;
+            else lo = min(ourHunks[i].baseStart, theirHunks[j].baseStart);
+            size_t hi = lo;
+            size_t oi = i, tj = j;
+            // Hunks from one side never touch each other (a matching line separates
+            // them), so anything starting at or before 'hi' overlaps the other side
+            for (;;) {
+                if (oi < ourHunks.size() && ourHunks[oi].baseStart <= hi) {
+                    hi = max(hi, ourHunks[oi++].baseEnd);
+                } else if (tj < theirHunks.size() && theirHunks[tj].baseStart <= hi) {
+                    hi = max(hi, theirHunks[tj++].baseEnd);
+                } else {
+                    break;
+                }
+            }
+
+            // Unchanged base lines before the region
+            appendLines(result, baseLines, basePos, lo);
+
+            // Each side's version of base lines [lo, hi)
+            long ourEnd = ourDelta, theirEnd = theirDelta;
+            for (size_t k = i; k < oi; k++) ourEnd += (long)(ourHunks[k].sideEnd - ourHunks[k].sideStart) - (long)(ourHunks[k].baseEnd - ourHunks[k].baseStart);
+            for (size_t k = j; k < tj; k++) theirEnd += (long)(theirHunks[k].sideEnd - theirHunks[k].sideStart) - (long)(theirHunks[k].baseEnd - theirHunks[k].baseStart);
+            size_t ourLo = lo + ourDelta, ourHi = hi + ourEnd;
+            size_t theirLo = lo + theirDelta, theirHi = hi + theirEnd;
+
+            if (oi == i) {
+                appendLines(result, theirLines, theirLo, theirHi);
+            } else if (tj == j) {
+                appendLines(result, ourLines, ourLo, ourHi);
+            } else if (sameLines(ourLines + ourLo, ourHi - ourLo, theirLines + theirLo, theirHi - theirLo)) {
+                appendLines(result, ourLines, ourLo, ourHi);
+            } else {
+                conflicts++;
+                result += "<<<<<<< " + oursLabel + "\n";
+                appendLines(result, ourLines, ourLo, ourHi);
+                terminateLine(result);
+                result += "=======\n";
+                appendLines(result, theirLines, theirLo, theirHi);
+                terminateLine(result);
+                result += ">>>>>>> " + theirsLabel + "\n";
+            }
+
+            basePos = hi;
+            ourDelta = ourEnd;
+            theirDelta = theirEnd;
+            i = oi;
+            j = tj;
+        }
+        appendLines(result, baseLines, basePos, nBase);
+        return conflicts;
+    }
+
+private:
+    static void appendLines(string& out, const LineSpan* lines, size_t from, size_t to) {
+        if (from >= to) return;
+        // Lines of one text are contiguous in memory
+        out.append(lines[from].ptr, (lines[to - 1].ptr + lines[to - 1].len) - lines[from].ptr);
+    }
+
+    static void terminateLine(string& out) {
+        if (!out.empty() && out.back() != '\n') out += '\n';
+    }
+
+    static bool sameLines(const LineSpan* a, size_t n, const LineSpan* b, size_t m) {
+        if (n != m) return false;
+        for (size_t k = 0; k < n; k++) if (!(a[k] == b[k])) return false;
+        return true;
+    }
+};
+
+// -------------------- Streaming JSON Writer --------------------
+// Writes JSON through a fixed-size buffer that is handed to a sink whenever it
+// fills, so serializing any amount of data needs constant memory. Strings are
+// escaped in one pass: a 256-entry table says which bytes need escaping, and
+// runs of bytes that do not are copied in one go.
+class JsonWriter {
+public:
+    typedef function<void(const char*, size_t)> Sink;
+
+    static Sink into(string& out) {
+        return [&out](const char* data, size_t n) { out.append(data, n); };
+    }
+    static Sink into(FILE* file) {
+        return [file](const char* data, size_t n) { fwrite(data, 1, n, file); };
+    }
+
+    explicit JsonWriter(Sink s, size_t capacity = 1 << 16) : sink(s), buffer(capacity), used(0) {}
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+    ~JsonWriter() { flush(); }
+
+    // Unescaped output: punctuation, keys and literals
+    JsonWriter& raw(const char* data, size_t n) {
+        if (n > buffer.size() - used) {
+            flush();
+            if (n >= buffer.size()) { sink(data, n); return *this; }
+        }
+        memcpy(buffer.data() + used, data, n);
+        used += n;
+        return *this;
+    }
+    JsonWriter& raw(const char* text) { return raw(text, strlen(text)); }
+    JsonWriter& raw(const string& text) { return raw(text.data(), text.size()); }
+
+    // A quoted, escaped string value
+    JsonWriter& str(const char* data, size_t n) {
+        static const char* hex = "0123456789abcdef";
+        const char* table = escapes();
+        raw("\"", 1);
+        size_t start = 0;
+        for (size_t i = 0; i < n; i++) {
+            unsigned char c = (unsigned char)data[i];
+            char e = table[c];
+            if (!e) continue;
+            raw(data + start, i - start);
+            if (e == 'u') {
+                char seq[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+                raw(seq, 6);
+            } else {
+                char seq[2] = {'\\', e};
+                raw(seq, 2);
+            }
+            start = i + 1;
+        }
+        raw(data + start, n - start);
+        return raw("\"", 1);
+    }
+    JsonWriter& str(const string& value) { return str(value.data(), value.size()); }
+
+    JsonWriter& boolean(bool value) { return value ? raw("true", 4) : raw("false", 5); }
+
+    JsonWriter& number(long long value) { return raw(to_string(value)); }
+
+    void flush() {
+        if (used) sink(buffer.data(), used);
+        used = 0;
+    }
+
+private:
+    Sink sink;
+    vector<char> buffer;
+    size_t used;
+
+    // For each byte: 0 if it is written as is, otherwise the character that
+    // follows the backslash ('u' for a \u00XX escape)
+    static const char* escapes() {
+        static const struct Table {
+            char e[256];
+            Table() {
+                memset(e, 0, sizeof(e));
+                for (int c = 0; c < 0x20; c++) e[c] = 'u';
+                e[(int)'"'] = '"';
+                e[(int)'\\'] = '\\';
+                e[(int)'\b'] = 'b';
+                e[(int)'\f'] = 'f';
+                e[(int)'\n'] = 'n';
+                e[(int)'\r'] = 'r';
+                e[(int)'\t'] = 't';
+            }
+        } table;
+        return table.e;
+    }
+};
+
+// -------------------- Branch Management System --------------------
+struct Branch {
+    Symbol branchName;
+    Symbol parentBranch;
+    FileTree files;
+    int head;               // Latest commit of this branch in the repository graph, -1 if none
+    Branch* left;
+    Branch* right;
+    Branch* parent;
+    vector<Branch*> children;
+    
+    Branch(Symbol name, Symbol parent = Symbol()) : branchName(name), parentBranch(parent), 
+           head(-1), left(NULL), right(NULL), parent(NULL) {}
+    
+    // Clear all files in this branch
+    void clearFiles() {
+        files.clear();
+    }
+    
+    // Share the file tree of another branch. The tree is persistent, so this is
+    // O(1) and later edits on either branch copy only the nodes they touch.
+    void copyFilesFrom(Branch* source) {
+        if (!source) return;
+        files = source->files;
+    }
+    
+    // Start this branch's history at the same commit as another branch
+    void copyCommitsFrom(Branch* source) {
+        if (!source) return;
+        head = source->head;
+    }
+    
+    // Destructor to clean up memory
+    ~Branch() {
+        clearFiles();
+    }
+};
+
+// One file taking part in a merge: its blob in the merge base, the target ("ours")
+// and the source ("theirs"); NULL means the file does not exist on that side
+struct FileMerge {
+    string name;
+    BlobRef base, ours, theirs;
+    BlobRef result;
+    bool conflict = false;
+};
+
+// What a merge did to the target branch
+struct MergeResult {
+    bool merged = false;        // False if either branch does not exist
+    int filesAdded = 0, filesUpdated = 0, filesDeleted = 0, commitsMerged = 0;
+    vector<string> conflicts;   // Conflicted file names, in name order
+};
+
+struct BranchManager {
+    Branch* root;
+    unordered_map<Symbol, Branch*> branchMap;   // Listed in name order by sortedBranches()
+    Symbol currentBranch;
+    CommitGraph graph;
+    
+    BranchManager() : root(NULL), currentBranch("main") {
+        // Create main branch
+        root = new Branch(currentBranch);
+        branchMap[currentBranch] = root;
+    }
+    
+    // Never inserts into the map or the symbol table, so names from requests
+    // can be looked up under a shared lock
+    Branch* findBranch(string_view name) const {
+        Symbol symbol;
+        if (!Symbol::lookup(name, symbol)) return NULL;
+        auto it = branchMap.find(symbol);
+        return it == branchMap.end() ? NULL : it->second;
+    }
+    
+    bool createBranch(string baseBranch, string newBranch) {
+        if (findBranch(newBranch)) {
+            return false; // Branch already exists
+        }
+        
+        Branch* base = findBranch(baseBranch);
+        if (!base) return false;
+        
+        Branch* newBr = new Branch(newBranch, base->branchName);
+        
+        // Share the file tree and point at the same commit as the base branch
+        newBr->copyFilesFrom(base);
+        newBr->copyCommitsFrom(base);
+        
+        // Set up branch relationships
+        newBr->parent = base;
+        base->children.push_back(newBr);
+        branchMap[newBr->branchName] = newBr;
+        
+        return true;
+    }
+    
+    bool switchBranch(string branchName) {
+        Branch* branch = findBranch(branchName);
+        if (!branch) {
+            return false;
+        }
+        currentBranch = branch->branchName;
+        return true;
+    }
+    
+    // Never inserts, so readers can call it under a shared lock
+    Branch* getCurrentBranch() {
+        auto it = branchMap.find(currentBranch);
+        return it == branchMap.end() ? NULL : it->second;
+    }
+    
+    // Record a commit on a branch, snapshotting its current files
+    void commit(Branch* branch, string action, Symbol user, int64_t when) {
+        vector<int> parents;
+        if (branch->head >= 0) parents.push_back(branch->head);
+        branch->head = graph.addCommit(parents, action, user, branch->files, when);
+    }
+    
+    // Commits of a branch in the order they were made
+    vector<const CommitNode*> branchHistory(Branch* branch) {
+        vector<const CommitNode*> result;
+        for (int index : graph.history(branch->head)) result.push_back(&graph.commits[index]);
+        return result;
+    }
+    
+    // Every branch, ordered by name
+    vector<Branch*> sortedBranches() const {
+        vector<Branch*> branches;
+        for (auto& pair : branchMap) {
+            if (pair.second) branches.push_back(pair.second);
+        }
+        sort(branches.begin(), branches.end(), [](const Branch* a, const Branch* b) {
+            return a->branchName.str() < b->branchName.str();
+        });
+        return branches;
+    }
+    
+    vector<string> listBranches() {
+        vector<string> branches;
+        for (Branch* branch : sortedBranches()) {
+            branches.push_back(branch->branchName);
+        }
+        return branches;
+    }
+    
+    MergeResult mergeBranch(string sourceBranch, string targetBranch, int64_t when = time(0)) {
+        MergeResult merge;
+        Branch* source = findBranch(sourceBranch);
+        Branch* target = findBranch(targetBranch);
+        
+        if (!source || !target) return merge;
+        
+        cout << "Merging branch '" << sourceBranch << "' into '" << targetBranch << "'...\n";
+        
+        // Step 1: Three-way merge of every file that differs from the merge base
+        const CommitNode* baseCommit = graph.get(graph.mergeBase(target->head, source->head));
+        FileTree baseFiles = baseCommit ? baseCommit->tree : FileTree();
+        
+        vector<FileMerge> work = collectChanges(baseFiles, target->files, source->files);
+        WorkStealingPool::instance().parallelFor(work.size(), [&](size_t i) {
+            // Each worker reuses its own diff arena
+            static thread_local Arena arena;
+            resolve(work[i], targetBranch, sourceBranch, arena);
+            arena.reset();
+        }, 8);
+        
+        // Apply results in name order so output and the resulting tree are deterministic
+        for (const FileMerge& item : work) {
+            if (item.result != item.ours) {
+                if (item.result) target->files.put(item.name, item.result);
+                else target->files.erase(item.name);
+            }
+            if (item.conflict) {
+                merge.conflicts.push_back(item.name);
+                cout << "  CONFLICT (" << (item.result && item.ours && item.theirs ? "content" : "modify/delete")
+                     << "): " << item.name << "\n";
+            } else if (!item.result) {
+                merge.filesDeleted++;
+                cout << "  Deleted: " << item.name << "\n";
+            } else if (!item.ours) {
+                merge.filesAdded++;
+                cout << "  Added: " << item.name << "\n";
+            } else {
+                merge.filesUpdated++;
+                cout << "  Updated: " << item.name << "\n";
+            }
+        }
+        
+        // Step 2: Count source commits the target does not have yet
+        vector<char> inTarget = graph.reachable(target->head);
+        vector<char> inSource = graph.reachable(source->head);
+        for (size_t i = 0; i < inSource.size(); i++) {
+            if (inSource[i] && !inTarget[i]) merge.commitsMerged++;
+        }
+        
+        // Step 3: Add merge commit to target branch
+        size_t conflicts = merge.conflicts.size();
+        string mergeMessage = "Merged branch " + sourceBranch + " into " + targetBranch;
+        if (merge.filesAdded > 0 || merge.filesUpdated > 0 || merge.filesDeleted > 0 || merge.commitsMerged > 0 || conflicts > 0) {
+            mergeMessage += " (" + to_string(merge.filesAdded) + " files added, " + 
+                           to_string(merge.filesUpdated) + " files updated, " + 
+                           (merge.filesDeleted > 0 ? to_string(merge.filesDeleted) + " files deleted, " : "") +
+                           to_string(merge.commitsMerged) + " commits merged" +
+                           (conflicts > 0 ? ", " + to_string(conflicts) + " conflicts" : "") + ")";
+        }
+        vector<int> parents;
+        if (target->head >= 0) parents.push_back(target->head);
+        if (source->head >= 0 && !inTarget[source->head]) parents.push_back(source->head);
+        target->head = graph.addCommit(parents, mergeMessage, "System", target->files, when);
+        
+        cout << "Merge completed: " << merge.filesAdded << " files added, " 
+             << merge.filesUpdated << " files updated, " << merge.filesDeleted << " files deleted, "
+             << merge.commitsMerged << " commits merged, " << conflicts << " conflicts.\n";
+        
+        merge.merged = true;
+        return merge;
+    }
+    
+    // Files whose source version differs from both the base and the target, in name order.
+    // The comparison runs on the thread pool; each slot of 'found' belongs to one file,
+    // so the result does not depend on scheduling.
+    static vector<FileMerge> collectChanges(const FileTree& base, const FileTree& ours, const FileTree& theirs) {
+        vector<const File*> theirFiles, ourFiles;
+        theirFiles.reserve(theirs.size());
+        ourFiles.reserve(ours.size());
+        theirs.forEach([&](const File& f) { theirFiles.push_back(&f); });
+        ours.forEach([&](const File& f) { ourFiles.push_back(&f); });
+        base.warmIndex();
+        ours.warmIndex();
+        theirs.warmIndex();
+        
+        vector<FileMerge> found(theirFiles.size() + ourFiles.size());
+        vector<char> used(found.size(), 0);
+        WorkStealingPool::instance().parallelFor(found.size(), [&](size_t i) {
+            if (i < theirFiles.size()) {
+                const File& f = *theirFiles[i];
+                const File* o = ours.find(f.name);
+                const File* b = base.find(f.name);
+                BlobRef ob = o ? o->blob : BlobRef(), bb = b ? b->blob : BlobRef();
+                if (f.blob != ob && f.blob != bb) {
+                    found[i] = FileMerge{f.name, bb, ob, f.blob, BlobRef()};
+                    used[i] = 1;
+                }
+            } else {
+                // Files deleted on the source side
+                const File& f = *ourFiles[i - theirFiles.size()];
+                if (theirs.find(f.name)) return;
+                const File* b = base.find(f.name);
+                if (b) {
+                    found[i] = FileMerge{f.name, b->blob, f.blob, BlobRef(), BlobRef()};
+                    used[i] = 1;
+                }
+            }
+        }, 1024);
+        
+        vector<FileMerge> work;
+        for (size_t i = 0; i < found.size(); i++) {
+            if (used[i]) work.push_back(move(found[i]));
+        }
+        // Both halves are already in name order
+        inplace_merge(work.begin(), work.begin() + count(used.begin(), used.begin() + theirFiles.size(), 1), work.end(),
+                      [](const FileMerge& x, const FileMerge& y) { return x.name < y.name; });
+        return work;
+    }
+    
+    // Decide the merged blob for one file
+    static void resolve(FileMerge& item, const string& oursLabel, const string& theirsLabel, Arena& arena) {
+        if (item.ours == item.base) {
+            // Only the source changed the file (including deleting it)
+            item.result = item.theirs;
+        } else if (!item.ours || !item.theirs) {
+            // Modified on one side, deleted on the other: keep the modified version
+            item.result = item.ours ? item.ours : item.theirs;
+            item.conflict = true;
+        } else {
+            static const string empty;
+            string merged;
+            int regions = ThreeWayMerge::mergeText(item.base ? item.base->data : empty, item.ours->data,
+                                                   item.theirs->data, oursLabel, theirsLabel, merged, arena);
+            item.result = BlobStore::instance().intern(merged);
+            item.conflict = regions > 0;
+        }
+    }
+    
+    // Write the branches as a JSON array
+    void writeBranches(JsonWriter& json) {
+        json.raw("[");
+        bool first = true;
+        for (Branch* branch : sortedBranches()) {
+            if (!first) json.raw(",");
+            json.raw("{\"name\":").str(branch->branchName)
+                .raw(",\"parent\":").str(branch->parentBranch)
+                .raw(",\"current\":").boolean(branch->branchName == currentBranch).raw("}");
+            first = false;
+        }
+        json.raw("]");
+    }
+
+    string getBranchesJSON() {
+        string out;
+        JsonWriter json(JsonWriter::into(out));
+        json.raw("{\"branches\":");
+        writeBranches(json);
+        json.raw(",\"currentBranch\":").str(currentBranch).raw("}");
+        json.flush();
+        return out;
+    }
+    
+    // Destructor to clean up all branches
+    ~BranchManager() {
+        for (auto& pair : branchMap) {
+            delete pair.second;
+        }
+        branchMap.clear();
+    }
+};
+
+class SnapshotImage;
+
+struct Repository {
+    string repoName;
+    string description;
+    bool isPrivate;
+    NodePool nodes;         // File tree nodes of every branch and commit; declared before them so it outlives them
+    BranchManager branchManager;
+    TaskQueue tasks;        // Requests push and pop it holding only the shared lock
+    mutex taskOrder;        // Held over a push or claim and its log record, so the log has the queue's order
+    Repository* next;
+    Repository* prev;       // Doubly linked so a repository can be unlinked in O(1)
+    // Set while the contents are still only in the snapshot file; GitHub decodes
+    // the section at imageOffset the first time the repository is touched
+    shared_ptr<const SnapshotImage> image;
+    size_t imageOffset = 0, imageLength = 0;
+    uint32_t imageChecksum = 0;
+    // Web requests hold this shared to read the repository and exclusive to change it
+    shared_mutex lock;
+    bool deleted = false;   // Set under the exclusive lock; a writer that finds it set treats the repository as gone
+    Repository(string n, string desc = "", bool priv = false) : repoName(n), description(desc), isPrivate(priv), next(NULL), prev(NULL) {
+        branchManager.root->files.pool = &nodes;    // Other branches start as copies of a tree that has it
+    }
+    
+    FileTree* getCurrentFiles() {
+        Branch* current = branchManager.getCurrentBranch();
+        return current ? &current->files : NULL;
+    }
+};
+
+typedef shared_ptr<Repository> RepoRef;
+
+// -------------------- Repository Catalog --------------------
+// Immutable view of the repository set for readers (RCU style). A request takes
+// the current catalog without locking and keeps it until it finishes; a deleted
+// repository lives on until the last catalog holding it is released, so the
+// reference count stands in for the grace period. Writers change GitHub's own
+// list, map and index under a mutex and bump the version, and the next reader
+// publishes a new catalog, so a burst of writes costs one rebuild.
+struct RepoCatalog {
+    uint64_t version = 0;
+    unordered_map<string, RepoRef> byName;
+    vector<Repository*> order;      // Newest first, as in the list
+    RepoIndex index;
+
+    RepoRef find(const string& name) const {
+        auto it = byName.find(name);
+        return it == byName.end() ? nullptr : it->second;
+    }
+};
+
+typedef shared_ptr<const RepoCatalog> CatalogRef;
+
+// -------------------- Operation Struct for Undo/Redo --------------------
+struct Operation {
+    Symbol type;       // One of the kinds below
+    Symbol repoName;
+    string fileName;
+    BlobRef content;   // File contents share the blob held by the tree; task text is interned too
+
+    // Interned once, so checking an operation's kind is an integer compare
+    static inline const Symbol createRepo{"createRepo"}, deleteRepo{"deleteRepo"}, createFile{"createFile"},
+        editFile{"editFile"}, deleteFile{"deleteFile"}, addTask{"addTask"}, removeTask{"removeTask"};
+
+    Operation() : content(BlobStore::instance().intern("")) {}
+    Operation(Symbol t, Symbol repo, string file, BlobRef blob) : type(t), repoName(repo), fileName(file), content(blob) {}
+    Operation(Symbol t, Symbol repo, string file, string_view text)
+        : type(t), repoName(repo), fileName(file), content(BlobStore::instance().intern(text)) {}
+
+    const string& text() const { return content->data; }
+};
+
+// Bounded undo or redo stack. Past either limit the oldest operations are
+// dropped, so a long session keeps only its recent history. An operation is
+// charged its full content size even though an edit's blob is usually shared
+// with the commit graph, which keeps the bound honest for blobs only the
+// history still holds.
+class OperationHistory {
+    deque<Operation> ops;       // Oldest first; the top of the stack is at the back
+    size_t totalBytes = 0;
+    size_t maxOperations, maxBytes;
+    uint64_t droppedCount = 0;
+
+    static size_t cost(const Operation& op) {
+        return sizeof(Operation) + op.fileName.size() + op.text().size();    // Symbols are shared
+    }
+
+    void trim() {
+        while (!ops.empty() && (ops.size() > maxOperations || totalBytes > maxBytes)) {
+            totalBytes -= cost(ops.front());
+            ops.pop_front();
+            droppedCount++;
+        }
+    }
+
+public:
+    static const size_t kDefaultOperations = 1000;
+    static const size_t kDefaultBytes = 64 << 20;
+
+    OperationHistory(size_t operations = kDefaultOperations, size_t bytes = kDefaultBytes)
+        : maxOperations(operations), maxBytes(bytes) {}
+
+    void push(Operation op) {
+        totalBytes += cost(op);
+        ops.push_back(move(op));
+        trim();
+    }
+
+    const Operation& top() const { return ops.back(); }
+
+    void pop() {
+        totalBytes -= cost(ops.back());
+        ops.pop_back();
+    }
+
+    // Undo and redo swap the content of an edit for the version they replaced
+    void setTopContent(BlobRef content) {
+        if (ops.empty()) return;    // The operation was itself too large to keep
+        totalBytes -= cost(ops.back());
+        ops.back().content = content;
+        totalBytes += cost(ops.back());
+        trim();
+    }
+
+    bool empty() const { return ops.empty(); }
+    size_t size() const { return ops.size(); }
+    size_t bytes() const { return totalBytes; }
+    uint64_t dropped() const { return droppedCount; }
+    size_t operationLimit() const { return maxOperations; }
+    size_t byteLimit() const { return maxBytes; }
+
+    // The i-th operation counting from the bottom (oldest)
+    const Operation& at(size_t i) const { return ops[i]; }
+    // The i-th operation counting from the top (next to undo or redo)
+    const Operation& fromTop(size_t i) const { return ops[ops.size() - 1 - i]; }
+
+    void setLimits(size_t operations, size_t bytes) {
+        maxOperations = operations;
+        maxBytes = bytes;
+        trim();
+    }
+};
+
+// -------------------- Write-Ahead Log --------------------
+// Mutations are appended to a log as one framed record each instead of rewriting
+// data.json. A frame is a 16-byte header (sequence number, payload length,
+// checksum) followed by the payload: the record's fields, each written as
+// "<length>:<bytes>". A torn or corrupt frame marks the end of the log.
+struct LogRecord {
+    uint64_t seq;
+    vector<string> fields;
+
+    static const size_t kHeaderSize = 16;
+
+    static uint32_t checksum(uint64_t seq, const char* data, size_t n) {
+        uint64_t h = 14695981039346656037ULL ^ seq;
+        for (size_t i = 0; i < n; i++) {
+            h ^= (unsigned char)data[i];
+            h *= 1099511628211ULL;
+        }
+        return (uint32_t)(mixHash(h) >> 32);
+    }
+
+    static void putInt(string& out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) out += (char)((value >> (i * 8)) & 0xff);
+    }
+
+    static uint64_t getInt(const string& data, size_t pos, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) value |= (uint64_t)(unsigned char)data[pos + i] << (i * 8);
+        return value;
+    }
+
+    // Append the frame for a record to out. Fields are written straight into it,
+    // so a large file body is copied once on its way to the log.
+    static void frame(string& out, uint64_t seq, const vector<string_view>& fields) {
+        size_t start = out.size();
+        putInt(out, seq, 8);
+        putInt(out, 0, 8);   // Length and checksum, filled in below
+        for (string_view field : fields) {
+            out += to_string(field.size());
+            out += ':';
+            out += field;
+        }
+        size_t length = out.size() - start - kHeaderSize;
+        string header;
+        putInt(header, length, 4);
+        putInt(header, checksum(seq, out.data() + start + kHeaderSize, length), 4);
+        out.replace(start + 8, 8, header);
+    }
+
+    // Parse the frame starting at pos. Returns its length, or 0 if it is torn or corrupt.
+    static size_t parse(const string& data, size_t pos, LogRecord& record) {
+        if (data.size() - pos < kHeaderSize) return 0;
+        uint64_t seq = getInt(data, pos, 8);
+        size_t length = getInt(data, pos + 8, 4);
+        uint32_t sum = (uint32_t)getInt(data, pos + 12, 4);
+        size_t start = pos + kHeaderSize;
+        if (data.size() - start < length) return 0;
+        if (checksum(seq, data.data() + start, length) != sum) return 0;
+
+        record.seq = seq;
+        record.fields.clear();
+        size_t i = start, end = start + length;
+        while (i < end) {
+            size_t colon = data.find(':', i);
+            if (colon == string::npos || colon >= end || colon == i) return 0;
+            size_t n = 0;
+            for (size_t k = i; k < colon; k++) {
+                if (data[k] < '0' || data[k] > '9') return 0;
+                n = n * 10 + (data[k] - '0');
+            }
+            if (end - colon - 1 < n) return 0;
+            record.fields.push_back(data.substr(colon + 1, n));
+            i = colon + 1 + n;
+        }
+        return kHeaderSize + length;
+    }
+};
+
+// Flush a file all the way to the disk
+static bool syncToDisk(FILE* file) {
+    if (fflush(file) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Append-only operation log with group commit: writers append under a short lock
+// and then wait in sync(). Whoever finds no flush in progress writes everything
+// pending with a single fsync, so concurrent writers share one fsync.
+class OpLog {
+private:
+    string path;
+    FILE* file = NULL;
+    mutex lock;
+    condition_variable flushed;
+    string pending;             // Frames appended but not written yet
+    uint64_t lastSeq = 0;       // Newest appended record
+    uint64_t durableSeq = 0;    // Every record up to this one is on disk
+    bool flushing = false;
+    size_t fileBytes = 0;
+
+    // Append and fsync a batch; only the thread that set flushing calls this. On
+    // failure the file is cut back to goodBytes so a torn record is not left in
+    // front of the retry. If it cannot be cut back the log is closed and every
+    // later sync() fails rather than write behind the torn bytes.
+    bool writeBatch(const string& batch, size_t goodBytes) {
+        if (file && fwrite(batch.data(), 1, batch.size(), file) == batch.size() && syncToDisk(file)) return true;
+        cout << "Failed to write " << path << "\n";
+        if (file) fclose(file);
+        file = NULL;
+        error_code ec;
+        filesystem::resize_file(path, goodBytes, ec);
+        if (!ec) file = fopen(path.c_str(), "ab");
+        return false;
+    }
+
+public:
+    ~OpLog() { close(); }
+
+    // Replay the records newer than afterSeq, cut off a torn tail left by a crash
+    // and open the log for appending
+    bool open(const string& logPath, uint64_t afterSeq, const function<void(const vector<string>&)>& replay) {
+        close();
+        path = logPath;
+        string data;
+        ifstream in(path, ios::binary);
+        if (in) {
+            stringstream buffer;
+            buffer << in.rdbuf();
+            data = buffer.str();
+        }
+        in.close();
+
+        lastSeq = afterSeq;
+        size_t pos = 0;
+        LogRecord record;
+        while (pos < data.size()) {
+            size_t length = LogRecord::parse(data, pos, record);
+            if (!length) break;
+            if (record.seq > lastSeq) {
+                replay(record.fields);
+                lastSeq = record.seq;
+            }
+            pos += length;
+        }
+        if (pos < data.size()) {
+            error_code ec;
+            filesystem::resize_file(path, pos, ec);
+        }
+
+        file = fopen(path.c_str(), "ab");
+        fileBytes = pos;
+        durableSeq = lastSeq;
+        return file != NULL;
+    }
+
+    void close() {
+        if (file) fclose(file);
+        file = NULL;
+    }
+
+    // Queue a record; it is durable once sync() returns for its sequence number
+    uint64_t append(const vector<string_view>& fields) {
+        lock_guard<mutex> guard(lock);
+        LogRecord::frame(pending, ++lastSeq, fields);
+        return lastSeq;
+    }
+
+    // Returns false if the records up to seq could not be made durable. They stay
+    // pending, ahead of anything appended since, and the next sync() retries them.
+    bool sync(uint64_t seq) {
+        unique_lock<mutex> guard(lock);
+        while (durableSeq < seq) {
+            if (flushing) {
+                flushed.wait(guard);
+                continue;
+            }
+            flushing = true;
+            string batch;
+            batch.swap(pending);
+            uint64_t target = lastSeq;
+            size_t goodBytes = fileBytes;
+            guard.unlock();
+            bool ok = writeBatch(batch, goodBytes);
+            guard.lock();
+            flushing = false;
+            flushed.notify_all();
+            if (!ok) {
+                pending.insert(0, batch);
+                return false;
+            }
+            fileBytes += batch.size();
+            durableSeq = target;
+        }
+        return true;
+    }
+
+    uint64_t lastSequence() {
+        lock_guard<mutex> guard(lock);
+        return lastSeq;
+    }
+
+    size_t size() {
+        lock_guard<mutex> guard(lock);
+        return fileBytes + pending.size();
+    }
+
+    // Empty the log once a snapshot covers every record in it. The caller must
+    // have synced and must keep other writers out until this returns.
+    void truncate() {
+        unique_lock<mutex> guard(lock);
+        flushed.wait(guard, [this] { return !flushing; });
+        if (file) fclose(file);
+        file = fopen(path.c_str(), "wb");
+        fileBytes = 0;
+    }
+};
+
+// -------------------- Binary Snapshot --------------------
+// Compaction writes the whole state to data.snapshot:
+//   header     magic, format version, repository count, the last log sequence
+//              number it covers, and the offset, length and checksum of the directory
+//   sections   one self-contained section per repository: its blobs, tree nodes
+//              (children first, shared subtrees once), commit graph, branches and tasks
+//   directory  name, description, visibility and section offset, length and
+//              checksum of every repository, then the undo/redo stacks; from
+//              version 2 an operation's text may be a TextDelta against the
+//              previous text written for the same file, and the stacks' limits follow
+// Version 3 stores commit dates as seconds since the epoch instead of ctime() text.
+// Integers are little-endian; strings are a u32 length followed by the bytes.
+// Startup reads only the header and directory; each section is decoded the
+// first time its repository is touched.
+static const char kSnapshotMagic[8] = {'G', 'H', 'S', 'N', 'A', 'P', '\r', '\n'};
+static const uint32_t kSnapshotVersion = 3;
+static const size_t kSnapshotHeaderSize = 48;
+
+struct ByteWriter {
+    string out;
+    void u8(uint8_t v) { out += (char)v; }
+    void u32(uint32_t v) { LogRecord::putInt(out, v, 4); }
+    void u64(uint64_t v) { LogRecord::putInt(out, v, 8); }
+    void str(const string& s) { u32((uint32_t)s.size()); out += s; }
+};
+
+// Reads from a span of the image; reading past its end clears ok and yields zeros
+struct ByteReader {
+    const char* pos;
+    const char* end;
+    bool ok = true;
+
+    ByteReader(const char* data, size_t n) : pos(data), end(data + n) {}
+
+    bool need(size_t n) {
+        if ((size_t)(end - pos) < n) ok = false;
+        return ok;
+    }
+    uint64_t uint(int bytes) {
+        if (!need(bytes)) return 0;
+        uint64_t v = 0;
+        for (int i = 0; i < bytes; i++) v |= (uint64_t)(unsigned char)pos[i] << (i * 8);
+        pos += bytes;
+        return v;
+    }
+    uint8_t u8() { return (uint8_t)uint(1); }
+    uint32_t u32() { return (uint32_t)uint(4); }
+    uint64_t u64() { return uint(8); }
+    string str() {
+        uint32_t n = u32();
+        if (!need(n)) return string();
+        string s(pos, n);
+        pos += n;
+        return s;
+    }
+};
+
+// Line delta between two versions of a text: a u32 hunk count, then for each
+// hunk the range of base lines it replaces and the bytes that replace them.
+// Undo/redo history in the snapshot is stored this way, since operations on one
+// file usually hold successive versions of it.
+struct TextDelta {
+    static string encode(const string& base, const string& target) {
+        static thread_local Arena arena;
+        LineSpan* a;
+        LineSpan* b;
+        size_t n = LineDiff::splitLines(base, arena, a);
+        size_t m = LineDiff::splitLines(target, arena, b);
+        vector<DiffHunk> hunks = LineDiff::diff(a, n, b, m, arena);
+        ByteWriter delta;
+        delta.u32((uint32_t)hunks.size());
+        for (const DiffHunk& h : hunks) {
+            size_t from = h.sideStart < m ? b[h.sideStart].ptr - target.data() : target.size();
+            size_t to = h.sideEnd < m ? b[h.sideEnd].ptr - target.data() : target.size();
+            delta.u32((uint32_t)h.baseStart);
+            delta.u32((uint32_t)h.baseEnd);
+            delta.str(target.substr(from, to - from));
+        }
+        arena.reset();
+        return delta.out;
+    }
+
+    // Rebuild the target from its base; false if the delta does not fit the base
+    static bool apply(const string& base, const string& delta, string& out) {
+        vector<size_t> lineStarts(1, 0);    // Offset of each base line, then the end
+        for (size_t i = 0; i < base.size(); i++) if (base[i] == '\n') lineStarts.push_back(i + 1);
+        if (lineStarts.back() != base.size()) lineStarts.push_back(base.size());
+        ByteReader in(delta.data(), delta.size());
+        size_t line = 0;
+        out.clear();
+        for (uint32_t n = in.u32(); in.ok && n > 0; n--) {
+            uint32_t start = in.u32(), end = in.u32();
+            string replacement = in.str();
+            if (!in.ok || start < line || end < start || end >= lineStarts.size()) return false;
+            out.append(base, lineStarts[line], lineStarts[start] - lineStarts[line]);
+            out += replacement;
+            line = end;
+        }
+        if (!in.ok || in.pos != in.end) return false;
+        out.append(base, lineStarts[line], string::npos);
+        return true;
+    }
+};
+
+// Read-only view of a snapshot file: memory-mapped where mmap exists, read into
+// memory otherwise. Either way it stays valid after the file is replaced.
+class SnapshotImage {
+private:
+    const char* bytes = NULL;
+    size_t length = 0;
+#ifdef _WIN32
+    string buffer;
+#endif
+
+public:
+    SnapshotImage() {}
+    SnapshotImage(const SnapshotImage&) = delete;
+    SnapshotImage& operator=(const SnapshotImage&) = delete;
+
+    static shared_ptr<const SnapshotImage> open(const string& path) {
+        shared_ptr<SnapshotImage> image = make_shared<SnapshotImage>();
+#ifdef _WIN32
+        ifstream in(path, ios::binary);
+        if (!in) return NULL;
+        stringstream contents;
+        contents << in.rdbuf();
+        image->buffer = contents.str();
+        image->bytes = image->buffer.data();
+        image->length = image->buffer.size();
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return NULL;
+        struct stat info;
+        void* mapped = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+            mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) return NULL;
+        image->bytes = (const char*)mapped;
+        image->length = (size_t)info.st_size;
+#endif
+        return image;
+    }
+
+    ~SnapshotImage() {
+#ifndef _WIN32
+        if (bytes) munmap((void*)bytes, length);
+#endif
+    }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    // Format version from the header; sections of older versions are decoded differently
+    uint32_t version() const {
+        ByteReader in(bytes, length);
+        if (!in.need(kSnapshotHeaderSize)) return 0;
+        in.pos += sizeof(kSnapshotMagic);
+        return in.u32();
+    }
+};
+
+// -------------------- Metrics --------------------
+// Latency histograms and request, error and byte counters for every API route
+// and persistence step, exposed in Prometheus text format by GET /api/metrics.
+// Each thread records into its own shard, and only that thread writes it, so
+// recording is a few relaxed stores with no lock and no shared cache line. A
+// scrape sums the shards; a thread's counts move to a retired shard when it exits.
+class Metrics {
+public:
+    enum Family { kRequest, kPersist, kFamilyCount };
+
+    // Latencies in nanoseconds go into log-linear buckets, as in HdrHistogram:
+    // below 2^kSubBits each value has its own bucket, and every later power of
+    // two is split into 2^kSubBits buckets, so a bucket's bounds are within 1/16
+    // of each other. The last bucket also takes everything above 2^kMaxBits (69 s).
+    static const int kSubBits = 4;
+    static const int kMaxBits = 36;
+    static const int kBuckets = (kMaxBits - kSubBits + 1) << kSubBits;
+    static const size_t kMaxSeries = 32;
+
+    static int bucketOf(uint64_t ns) {
+        if (ns < (1u << kSubBits)) return (int)ns;
+#ifdef __GNUC__
+        int msb = 63 - __builtin_clzll(ns);
+#else
+        int msb = 0;
+        for (uint64_t v = ns >> 1; v; v >>= 1) msb++;
+#endif
+        if (msb >= kMaxBits) return kBuckets - 1;
+        int shift = msb - kSubBits;
+        return ((shift + 1) << kSubBits) + (int)((ns >> shift) & ((1u << kSubBits) - 1));
+    }
+
+    // Smallest value that falls in the next bucket
+    static uint64_t bucketLimit(int bucket) {
+        if (bucket < (1 << kSubBits)) return (uint64_t)bucket + 1;
+        int shift = (bucket >> kSubBits) - 1;
+        uint64_t sub = (uint64_t)(bucket & ((1 << kSubBits) - 1));
+        return ((1ULL << kSubBits) + sub + 1) << shift;
+    }
+
+private:
+    struct Counts {
+        atomic<uint64_t> requests, errors, bytes, nanos, maxNanos;
+        atomic<uint64_t> buckets[kBuckets];
+    };
+    struct Shard { Counts series[kMaxSeries]; };
+
+    struct Series { Family family; string label; };
+
+    Series names[kMaxSeries];
+    atomic<size_t> seriesCount{0};
+    mutex lock;                 // Taken to add a series or shard, retire a shard and scrape; never to record
+    vector<Shard*> shards;      // One per live thread that has recorded
+    Shard* retired = new Shard();
+
+    // Only the owning thread (or the retiring one, under the lock) writes a shard
+    static void bump(atomic<uint64_t>& counter, uint64_t by) {
+        counter.store(counter.load(memory_order_relaxed) + by, memory_order_relaxed);
+    }
+
+    Shard& localShard() {
+        struct Owner {
+            Shard* shard = NULL;
+            ~Owner() { if (shard) Metrics::instance().retire(shard); }
+        };
+        static thread_local Owner owner;
+        if (!owner.shard) {
+            owner.shard = new Shard();
+            lock_guard<mutex> guard(lock);
+            shards.push_back(owner.shard);
+        }
+        return *owner.shard;
+    }
+
+    void retire(Shard* shard) {
+        lock_guard<mutex> guard(lock);
+        for (size_t s = 0; s < kMaxSeries; s++) {
+            Counts& from = shard->series[s];
+            Counts& to = retired->series[s];
+            bump(to.requests, from.requests.load(memory_order_relaxed));
+            bump(to.errors, from.errors.load(memory_order_relaxed));
+            bump(to.bytes, from.bytes.load(memory_order_relaxed));
+            bump(to.nanos, from.nanos.load(memory_order_relaxed));
+            to.maxNanos.store(max(to.maxNanos.load(memory_order_relaxed), from.maxNanos.load(memory_order_relaxed)), memory_order_relaxed);
+            for (int b = 0; b < kBuckets; b++) bump(to.buckets[b], from.buckets[b].load(memory_order_relaxed));
+        }
+        shards.erase(find(shards.begin(), shards.end(), shard));
+        delete shard;
+    }
+
+public:
+    // Never destroyed: threads may still record while the process exits
+    static Metrics& instance() {
+        static Metrics* metrics = new Metrics();
+        return *metrics;
+    }
+
+    // Register a route or persistence step; returns the id to record under.
+    // Series are added once, as the route table and persistence steps are first
+    // used, so running out of slots is a build mistake and stops the program
+    // rather than mixing two series together.
+    size_t addSeries(Family family, string label) {
+        lock_guard<mutex> guard(lock);
+        size_t id = seriesCount.load(memory_order_relaxed);
+        if (id == kMaxSeries) {
+            fprintf(stderr, "Metrics: no slot for series '%s'; raise kMaxSeries above %zu\n", label.c_str(), kMaxSeries);
+            abort();
+        }
+        names[id] = Series{family, label};
+        seriesCount.store(id + 1, memory_order_release);
+        return id;
+    }
+
+    void record(size_t series, uint64_t nanos, uint64_t bytes, bool error) {
+        Counts& c = localShard().series[series];
+        bump(c.requests, 1);
+        if (error) bump(c.errors, 1);
+        bump(c.bytes, bytes);
+        bump(c.nanos, nanos);
+        if (nanos > c.maxNanos.load(memory_order_relaxed)) c.maxNanos.store(nanos, memory_order_relaxed);
+        bump(c.buckets[bucketOf(nanos)], 1);
+    }
+
+    // Times a block and records it when it ends
+    class Timer {
+        size_t series;
+        chrono::steady_clock::time_point start;
+    public:
+        uint64_t bytes = 0;
+        bool error = false;
+        explicit Timer(size_t s) : series(s), start(chrono::steady_clock::now()) {}
+        ~Timer() {
+            uint64_t ns = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+            Metrics::instance().record(series, ns, bytes, error);
+        }
+    };
+
+    // Every series as Prometheus histograms, quantile gauges and counters.
+    // Histogram buckets are summed from the fine buckets that end at or below
+    // each bound, so a count is exact to within one fine bucket (1/16).
+    void writePrometheus(string& out) {
+        static const struct { const char* name; const char* label; const char* what; const char* bytes; } families[kFamilyCount] = {
+            {"github_http_request", "route", "API requests", "Response body bytes serialized"},
+            {"github_persist", "operation", "persistence steps", "Bytes written"},
+        };
+        static const double bounds[] = {0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+                                        0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+        static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+        struct Total { uint64_t requests = 0, errors = 0, bytes = 0, nanos = 0, maxNanos = 0; vector<uint64_t> buckets; };
+        size_t count = seriesCount.load(memory_order_acquire);
+        vector<Total> totals(count);
+        {
+            lock_guard<mutex> guard(lock);
+            vector<Shard*> all = shards;
+            all.push_back(retired);
+            for (size_t s = 0; s < count; s++) {
+                Total& t = totals[s];
+                t.buckets.assign(kBuckets, 0);
+                for (Shard* shard : all) {
+                    const Counts& c = shard->series[s];
+                    t.requests += c.requests.load(memory_order_relaxed);
+                    t.errors += c.errors.load(memory_order_relaxed);
+                    t.bytes += c.bytes.load(memory_order_relaxed);
+                    t.nanos += c.nanos.load(memory_order_relaxed);
+                    t.maxNanos = max(t.maxNanos, c.maxNanos.load(memory_order_relaxed));
+                    for (int b = 0; b < kBuckets; b++) t.buckets[b] += c.buckets[b].load(memory_order_relaxed);
+                }
+            }
+        }
+
+        char line[512];
+        auto emit = [&](const char* format, auto... args) {
+            snprintf(line, sizeof(line), format, args...);
+            out += line;
+        };
+        for (int f = 0; f < kFamilyCount; f++) {
+            const char* name = families[f].name;
+            const char* label = families[f].label;
+            emit("# HELP %s_duration_seconds Latency of %s.\n# TYPE %s_duration_seconds histogram\n", name, families[f].what, name);
+            for (size_t s = 0; s < count; s++) {
+                if (names[s].family != f) continue;
+                const Total& t = totals[s];
+                const char* value = names[s].label.c_str();
+                uint64_t cumulative = 0;
+                int b = 0;
+                for (double bound : bounds) {
+                    uint64_t limit = (uint64_t)(bound * 1e9);
+                    for (; b < kBuckets && bucketLimit(b) <= limit; b++) cumulative += t.buckets[b];
+                    emit("%s_duration_seconds_bucket{%s=\"%s\",le=\"%g\"} %llu\n", name, label, value, bound, (unsigned long long)cumulative);
+                }
+                emit("%s_duration_seconds_bucket{%s=\"%s\",le=\"+Inf\"} %llu\n", name, label, value, (unsigned long long)t.requests);
+                emit("%s_duration_seconds_sum{%s=\"%s\"} %.9f\n", name, label, value, t.nanos / 1e9);
+                emit("%s_duration_seconds_count{%s=\"%s\"} %llu\n", name, label, value, (unsigned long long)t.requests);
+            }
+            emit("# HELP %s_duration_quantile_seconds Latency quantiles of %s since startup.\n# TYPE %s_duration_quantile_seconds gauge\n",
+                 name, families[f].what, name);
+            for (size_t s = 0; s < count; s++) {
+                if (names[s].family != f) continue;
+                const Total& t = totals[s];
+                for (double q : quantiles) {
+                    uint64_t rank = (uint64_t)ceil(q * t.requests), seen = 0, ns = 0;
+                    for (int b = 0; b < kBuckets && rank > 0; b++) {
+                        seen += t.buckets[b];
+                        if (seen >= rank) { ns = min(bucketLimit(b), t.maxNanos); break; }
+                    }
+                    emit("%s_duration_quantile_seconds{%s=\"%s\",quantile=\"%g\"} %.9f\n", name, label, names[s].label.c_str(), q, ns / 1e9);
+                }
+                emit("%s_duration_quantile_seconds{%s=\"%s\",quantile=\"1\"} %.9f\n", name, label, names[s].label.c_str(), t.maxNanos / 1e9);
+            }
+            emit("# HELP %s_errors_total Failed %s.\n# TYPE %s_errors_total counter\n", name, families[f].what, name);
+            for (size_t s = 0; s < count; s++) {
+                if (names[s].family == f) emit("%s_errors_total{%s=\"%s\"} %llu\n", name, label, names[s].label.c_str(), (unsigned long long)totals[s].errors);
+            }
+            emit("# HELP %s_bytes_total %s.\n# TYPE %s_bytes_total counter\n", name, families[f].bytes, name);
+            for (size_t s = 0; s < count; s++) {
+                if (names[s].family == f) emit("%s_bytes_total{%s=\"%s\"} %llu\n", name, label, names[s].label.c_str(), (unsigned long long)totals[s].bytes);
+            }
+        }
+    }
+};
+
+// -------------------- Request Router --------------------
+// Routes compile into a trie of path segments. A segment is a literal or a typed
+// parameter: {name} matches one non-empty segment, {name:int} one made of digits
+// and {name:path} the rest of the path, slashes included. Matching walks the
+// path once on string_views, trying literal children before the parameter at
+// each level, and allocates nothing: parameters are views into the target.
+struct RouteParams {
+    static const int kMaxParams = 4;
+    string_view values[kMaxParams];    // In the order they appear in the pattern
+    int count = 0;
+    string_view query;                  // After the '?', without it
+
+    string_view operator[](int i) const { return values[i]; }
+};
+
+// What a route answers: an HTTP status and a JSON body. A plain string is a
+// 200 answer; error() builds {"error":"..."} with the status that fits it:
+// 400 bad input, 404 unknown repository, file or branch, 409 conflict, 503 busy
+// and 500 when a change could not be saved.
+struct ApiResponse {
+    int status = 200;
+    string body;
+
+    ApiResponse() {}
+    ApiResponse(string json) : body(move(json)) {}
+    ApiResponse(const char* json) : body(json) {}
+    ApiResponse(int code, string json) : status(code), body(move(json)) {}
+
+    static ApiResponse error(int code, string_view message) {
+        return ApiResponse(code, "{\"error\":\"" + string(message) + "\"}");
+    }
+};
+
+// Undo %XX escapes (and '+' as a space for form values)
+static string percentDecode(string_view text, bool plusIsSpace = false) {
+    string out;
+    out.reserve(text.size());
+    auto hexValue = [](char c) { return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10; };
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (c == '%' && i + 2 < text.size() && isxdigit((unsigned char)text[i + 1]) && isxdigit((unsigned char)text[i + 2])) {
+            out += (char)(hexValue(text[i + 1]) * 16 + hexValue(text[i + 2]));
+            i += 2;
+        } else {
+            out += (plusIsSpace && c == '+') ? ' ' : c;
+        }
+    }
+    return out;
+}
+
+template <typename Handler>
+class RouteTrie {
+public:
+    enum Method { kGet, kPost, kPut, kDelete, kMethodCount };
+
+    static int methodIndex(string_view method) {
+        if (method == "GET") return kGet;
+        if (method == "POST") return kPost;
+        if (method == "PUT") return kPut;
+        if (method == "DELETE") return kDelete;
+        return -1;
+    }
+
+    // pattern: "/api/repositories/{repo}/files/{file:path}"
+    void add(const char* method, string_view pattern, Handler handler) {
+        Node* node = &root;
+        while (!pattern.empty()) {
+            pattern.remove_prefix(1);   // '/'
+            size_t slash = pattern.find('/');
+            string_view segment = pattern.substr(0, slash);
+            pattern = slash == string_view::npos ? string_view() : pattern.substr(slash);
+            if (segment.size() > 2 && segment.front() == '{' && segment.back() == '}') {
+                string_view spec = segment.substr(1, segment.size() - 2);
+                size_t colon = spec.find(':');
+                string_view type = colon == string_view::npos ? string_view() : spec.substr(colon + 1);
+                if (type == "path") {
+                    if (!node->tail) node->tail.reset(new Node());
+                    node = node->tail.get();
+                    break;      // Takes the rest of the path
+                }
+                if (!node->param) {
+                    node->param.reset(new Node());
+                    node->paramIsInt = (type == "int");
+                }
+                node = node->param.get();
+            } else {
+                Node* child = NULL;
+                for (auto& literal : node->literals) {
+                    if (literal.first == segment) child = literal.second.get();
+                }
+                if (!child) {
+                    node->literals.emplace_back(string(segment), unique_ptr<Node>(new Node()));
+                    child = node->literals.back().second.get();
+                }
+                node = child;
+            }
+        }
+        int m = methodIndex(method);
+        node->handlers[m] = handler;
+        node->has[m] = true;
+    }
+
+    bool match(string_view method, string_view target, Handler& handler, RouteParams& params) const {
+        int m = methodIndex(method);
+        if (m < 0) return false;
+        size_t question = target.find('?');
+        params.query = question == string_view::npos ? string_view() : target.substr(question + 1);
+        string_view path = target.substr(0, question);
+        if (path.empty() || path.front() != '/') return false;
+        params.count = 0;
+        return matchFrom(&root, path, m, handler, params);
+    }
+
+private:
+    struct Node {
+        vector<pair<string, unique_ptr<Node>>> literals;
+        unique_ptr<Node> param;
+        bool paramIsInt = false;
+        unique_ptr<Node> tail;     // {name:path}
+        Handler handlers[kMethodCount] = {};
+        bool has[kMethodCount] = {};
+    };
+    Node root;
+
+    // path is empty (every segment consumed) or starts with '/'
+    static bool matchFrom(const Node* node, string_view path, int m, Handler& handler, RouteParams& params) {
+        if (path.empty()) {
+            if (!node->has[m]) return false;
+            handler = node->handlers[m];
+            return true;
+        }
+        string_view remainder = path.substr(1);
+        size_t slash = remainder.find('/');
+        string_view segment = remainder.substr(0, slash);
+        string_view rest = slash == string_view::npos ? string_view() : remainder.substr(slash);
+
+        for (const auto& literal : node->literals) {
+            if (literal.first == segment && matchFrom(literal.second.get(), rest, m, handler, params)) return true;
+        }
+        if (node->param && !segment.empty() && params.count < RouteParams::kMaxParams &&
+            (!node->paramIsInt || segment.find_first_not_of("0123456789") == string_view::npos)) {
+            params.values[params.count++] = segment;
+            if (matchFrom(node->param.get(), rest, m, handler, params)) return true;
+            params.count--;
+        }
+        if (node->tail && !remainder.empty() && node->tail->has[m] && params.count < RouteParams::kMaxParams) {
+            params.values[params.count++] = remainder;
+            handler = node->tail->handlers[m];
+            return true;
+        }
+        return false;
+    }
+};
+
+// -------------------- Request Body Parser --------------------
+// Bodies are form-encoded (name=a%20b&content=...) or a flat JSON object
+// ({"name":"a b","content":"..."}). Both are parsed in one pass and decoded in
+// place: an escape is never shorter than what it decodes to, so the decoded text
+// is written over the encoded text and every field is a view into the caller's
+// buffer. Nothing is allocated, and a file body is first copied when it is
+// interned as a blob.
+struct FormFields {
+    static const int kMaxFields = 16;
+    string_view keys[kMaxFields];
+    string_view values[kMaxFields];
+    int count = 0;
+
+    // Returns false for malformed JSON or more than kMaxFields fields
+    bool parse(char* data, size_t length) {
+        count = 0;
+        size_t start = 0;
+        while (start < length && isspace((unsigned char)data[start])) start++;
+        if (start < length && data[start] == '{') return parseJson(data + start + 1, data + length);
+        return parseForm(data, data + length);
+    }
+
+    bool has(string_view key) const {
+        for (int i = 0; i < count; i++) if (keys[i] == key) return true;
+        return false;
+    }
+
+    string_view get(string_view key, string_view def = string_view()) const {
+        for (int i = 0; i < count; i++) if (keys[i] == key) return values[i];
+        return def;
+    }
+
+private:
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        c |= 0x20;
+        return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+    }
+
+    static char* find(char* p, char* end, char c) {
+        char* found = (char*)memchr(p, c, end - p);
+        return found ? found : end;
+    }
+
+    // Decode %XX and '+' in [p, end) over itself; returns the end of the decoded text.
+    // Runs between escapes are found with memchr and moved in one piece, and text
+    // without escapes is not written at all.
+    static char* decodeForm(char* p, char* end) {
+        char* out = p;
+        char* percent = find(p, end, '%');
+        char* plus = find(p, end, '+');
+        while (true) {
+            char* run = min(percent, plus);
+            if (out != p) memmove(out, p, run - p);
+            out += run - p;
+            p = run;
+            if (p == end) return out;
+            if (*p == '%' && end - p > 2 && hexValue(p[1]) >= 0 && hexValue(p[2]) >= 0) {
+                *out++ = (char)(hexValue(p[1]) * 16 + hexValue(p[2]));
+                p += 3;
+            } else {
+                *out++ = *p == '+' ? ' ' : *p;
+                p++;
+            }
+            if (percent < p) percent = find(p, end, '%');
+            if (plus < p) plus = find(p, end, '+');
+        }
+    }
+
+    bool parseForm(char* p, char* end) {
+        while (p < end) {
+            // Keys are short, so look for '=' first and then scan the value once for '&'
+            char* eq = find(p, end, '=');
+            char* amp = find(p, eq, '&');
+            if (amp == eq) amp = find(eq, end, '&');
+            else eq = NULL;   // A pair without a value, like "flag&..."
+            if (eq == end) eq = NULL;
+            char* keyEnd = eq ? eq : amp;
+            if (keyEnd > p) {   // Skip empty pairs such as "a=1&&b=2"
+                if (count == kMaxFields) return false;
+                keys[count] = string_view(p, decodeForm(p, keyEnd) - p);
+                values[count] = eq ? string_view(eq + 1, decodeForm(eq + 1, amp) - eq - 1) : string_view();
+                count++;
+            }
+            p = amp + 1;
+        }
+        return true;
+    }
+
+    static void skipSpace(char*& p, char* end) {
+        while (p < end && isspace((unsigned char)*p)) p++;
+    }
+
+    static int readHex4(const char* p) {
+        int value = 0;
+        for (int i = 0; i < 4; i++) {
+            int digit = hexValue(p[i]);
+            if (digit < 0) return -1;
+            value = value * 16 + digit;
+        }
+        return value;
+    }
+
+    // Decode the JSON string whose opening quote has been consumed. Leaves p past
+    // the closing quote; returns false if the string is unterminated or malformed.
+    static bool decodeJsonString(char*& p, char* end, string_view& result) {
+        char* start = p;
+        char* out = p;
+        while (p < end) {
+            char c = *p++;
+            if (c == '"') {
+                result = string_view(start, out - start);
+                return true;
+            }
+            if (c != '\\') { *out++ = c; continue; }
+            if (p == end) return false;
+            switch (char e = *p++) {
+                case 'b': *out++ = '\b'; break;
+                case 'f': *out++ = '\f'; break;
+                case 'n': *out++ = '\n'; break;
+                case 'r': *out++ = '\r'; break;
+                case 't': *out++ = '\t'; break;
+                case '"': case '\\': case '/': *out++ = e; break;
+                case 'u': {
+                    if (end - p < 4) return false;
+                    long code = readHex4(p);
+                    if (code < 0) return false;
+                    p += 4;
+                    // A surrogate pair (two escapes, 12 bytes) becomes one 4-byte character
+                    if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                        long low = readHex4(p + 2);
+                        if (low >= 0xDC00 && low < 0xE000) {
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                            p += 6;
+                        }
+                    }
+                    if (code < 0x80) {
+                        *out++ = (char)code;
+                    } else if (code < 0x800) {
+                        *out++ = (char)(0xC0 | (code >> 6));
+                        *out++ = (char)(0x80 | (code & 0x3F));
+                    } else if (code < 0x10000) {
+                        *out++ = (char)(0xE0 | (code >> 12));
+                        *out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+                        *out++ = (char)(0x80 | (code & 0x3F));
+                    } else {
+                        *out++ = (char)(0xF0 | (code >> 18));
+                        *out++ = (char)(0x80 | ((code >> 12) & 0x3F));
+                        *out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+                        *out++ = (char)(0x80 | (code & 0x3F));
+                    }
+                    break;
+                }
+                default: return false;
+            }
+        }
+        return false;
+    }
+
+    // p is just past the opening brace. Values may be strings or bare literals
+    // (true, 42, null), which are kept as written; nested objects are rejected.
+    bool parseJson(char* p, char* end) {
+        skipSpace(p, end);
+        if (p < end && *p == '}') return true;
+        while (p < end) {
+            if (*p++ != '"' || count == kMaxFields) return false;
+            if (!decodeJsonString(p, end, keys[count])) return false;
+            skipSpace(p, end);
+            if (p == end || *p++ != ':') return false;
+            skipSpace(p, end);
+            if (p == end) return false;
+            if (*p == '"') {
+                p++;
+                if (!decodeJsonString(p, end, values[count])) return false;
+            } else {
+                char* start = p;
+                while (p < end && *p != ',' && *p != '}' && !isspace((unsigned char)*p)) p++;
+                if (p == start || *start == '{' || *start == '[') return false;
+                values[count] = string_view(start, p - start);
+            }
+            count++;
+            skipSpace(p, end);
+            if (p == end) return false;
+            if (*p == '}') return true;
+            if (*p++ != ',') return false;
+            skipSpace(p, end);
+        }
+        return false;
+    }
+};
+
+// -------------------- GitHub Simulation --------------------
+class GitHub {
+private:
+    Repository* head = NULL;
+    unordered_map<string, RepoRef> repoMap;     // Exact-name lookup; always holds the same repos as repoIndex
+    RepoIndex repoIndex;
+    OperationHistory undoStack, redoStack;
+    CommitHistory commits;
+    Symbol currentUser = "Shiwani";
+    OpLog opLog;
+    bool storeOpen = false;     // Mutations go to the log once loadFromFile() has opened it
+    bool storeLoaded = false;   // Set by loadFromFile(); before that nothing is written to disk
+    // Set when the snapshot, or a repository's section of it, cannot be read. From
+    // then on nothing is saved and the snapshot is never rewritten, so the file and
+    // the log that applies on top of it stay as they were for recovery.
+    atomic<bool> storeDamaged{false};
+
+    // Web requests run on several threads. Locks are taken in this order:
+    //   catalogLock   adding or removing repositories (head, repoMap, repoIndex)
+    //   Repository::lock   shared to read one repository, exclusive to change it
+    //   journalLock   undo/redo stacks, and the log append that must match their order
+    // The console and the test methods are single-threaded and call the
+    // operations below directly, without locks.
+    mutex catalogLock;
+    mutex journalLock;
+    atomic<uint64_t> catalogVersion{newCatalogVersion()};
+    CatalogRef publishedCatalog;            // Read and written with atomic_load/atomic_store
+
+    static constexpr const char* kLogPath = "data.wal";
+    static constexpr const char* kSnapshotPath = "data.snapshot";
+    static const size_t kCompactBytes = 4 << 20;    // Fold the log into a snapshot past this size
+
+    // Link a repository in at the head of the list and index it by name
+    Repository* attachRepository(const string& name, const string& description, bool isPrivate) {
+        RepoRef ref = make_shared<Repository>(name, description, isPrivate);
+        Repository* repo = ref.get();
+        repo->next = head;
+        if (head) head->prev = repo;
+        head = repo;
+        repoMap[name] = ref;
+        repoIndex.insert(name);
+        catalogChanged();
+        return repo;
+    }
+
+    // Drop the published catalog too, so a deleted repository is freed as soon
+    // as the requests already holding it finish
+    void catalogChanged() {
+        catalogVersion.store(newCatalogVersion(), memory_order_release);
+        atomic_store(&publishedCatalog, CatalogRef());
+    }
+
+public:
+    // -------------------- Helper Functions --------------------
+    Repository* findRepo(const string& name) {
+        auto it = repoMap.find(name);
+        if (it == repoMap.end()) return NULL;
+        pageIn(it->second.get());
+        return it->second.get();
+    }
+
+    const File* findFile(Repository* repo, string name) {
+        FileTree* files = repo->getCurrentFiles();
+        return files ? files->find(name) : NULL;
+    }
+
+    // -------------------- Repository Operations --------------------
+    void createRepository(string name, string description = "", bool isPrivate = false, int64_t when = time(0)) {
+        if (repoIndex.contains(name)) { cout << "Repository already exists!\n"; return; }
+        attachRepository(name, description, isPrivate);
+        commits.addCommit("Created Repository: " + name + (isPrivate ? " (Private)" : " (Public)"), currentUser, when);
+        undoStack.push({Operation::deleteRepo, name, "", ""});
+        cout << "Repository '" << name << "' created " << (isPrivate ? "(Private)" : "(Public)") << ".\n";
+    }
+
+    void deleteRepository(string name, int64_t when = time(0)) {
+        auto found = repoMap.find(name);   // No need to page in a repository that is being deleted
+        if (found == repoMap.end()) { cout << "Repository not found.\n"; return; }
+        Repository* temp = found->second.get();
+        undoStack.push({Operation::createRepo, temp->repoName, "", ""});
+        if (temp->prev) temp->prev->next = temp->next; else head = temp->next;
+        if (temp->next) temp->next->prev = temp->prev;
+        // Requests may still hold the repository through a catalog; it is freed
+        // when the last of them lets go
+        temp->deleted = true;
+        repoIndex.erase(name);
+        catalogChanged();
+        commits.addCommit("Deleted Repository: " + name, currentUser, when);
+        repoMap.erase(found);
+        cout << "Repository deleted.\n";
+    }
+
+    void editRepository(Repository* repo, string description, bool isPrivate, int64_t when = time(0)) {
+        repo->description = description;
+        repo->isPrivate = isPrivate;
+        commits.addCommit("Edited Repository: " + repo->repoName + (isPrivate ? " (Private)" : " (Public)"), currentUser, when);
+        cout << "Repository '" << repo->repoName << "' updated.\n";
+    }
+
+    void showRepositories() {
+        if (!head) { cout << "No repositories.\n"; return; }
+        Repository* temp = head;
+        cout << "\nRepositories:\n";
+        while (temp) { cout << "- " << temp->repoName << endl; temp = temp->next; }
     }
 
     // -------------------- File Operations --------------------
-    void createFile(Repository* repo, string fileName, string content) {
+    void createFile(Repository* repo, string fileName, string content, int64_t when = time(0)) {
+        createFile(repo, fileName, BlobStore::instance().intern(content), when);
+    }
+
+    // Uploaded content is interned once and shared by the tree and the undo stack
+    void createFile(Repository* repo, const string& fileName, BlobRef content, int64_t when = time(0)) {
         if (findFile(repo, fileName)) { 
             cout << "File already exists!\n"; 
             return; 
         }
-        // Save the current state for undo
-        undoStack.push({"createFile", repo->repoName, fileName, content});
-        
-        // Perform the operation
-        File* newFile = new File(fileName, content);
-        File* currentFiles = repo->getCurrentFiles();
-        newFile->next = currentFiles;
-        repo->setCurrentFiles(newFile);
-        
-        // Add to commit history for current branch
-        Branch* currentBranch = repo->branchManager.getCurrentBranch();
-        if (currentBranch) {
-            currentBranch->commits.addCommit("Created File: " + fileName, currentUser);
+        // Save the current state for undo
+        undoStack.push({Operation::createFile, repo->repoName, fileName, content});
+        
+        // Perform the operation
+        repo->getCurrentFiles()->put(fileName, content);
+        
+        // Add to commit history for current branch
+        Branch* currentBranch = repo->branchManager.getCurrentBranch();
+        if (currentBranch) {
+            repo->branchManager.commit(currentBranch, "Created File: " + fileName, currentUser, when);
+        }
+        // Also add to global commit history for tracking
+        commits.addCommit("Created File: " + fileName + " in branch " + repo->branchManager.currentBranch.str(), currentUser, when);
+        cout << "File created successfully in branch " << repo->branchManager.currentBranch << ".\n";
+    }
+
+    void deleteFile(Repository* repo, string fileName, int64_t when = time(0)) {
+        const File* temp = findFile(repo, fileName);
+        if (!temp) { 
+            cout << "File not found.\n"; 
+            return; 
+        }
+        
+        // Save the current state for undo before deleting
+        undoStack.push({Operation::deleteFile, repo->repoName, temp->name, temp->blob});
+        
+        // Perform the operation
+        repo->getCurrentFiles()->erase(fileName);
+            
+        // Add to commit history for current branch
+        Branch* currentBranch = repo->branchManager.getCurrentBranch();
+        if (currentBranch) {
+            repo->branchManager.commit(currentBranch, "Deleted File: " + fileName, currentUser, when);
+        }
+        // Also add to global commit history for tracking
+        commits.addCommit("Deleted File: " + fileName + " in branch " + repo->branchManager.currentBranch.str(), currentUser, when);
+        cout << "File deleted successfully from branch " << repo->branchManager.currentBranch << ".\n";
+    }
+
+    void editFile(Repository* repo, string fileName, string newContent, int64_t when = time(0)) {
+        editFile(repo, fileName, BlobStore::instance().intern(newContent), when);
+    }
+
+    void editFile(Repository* repo, const string& fileName, BlobRef newContent, int64_t when = time(0)) {
+        const File* temp = findFile(repo, fileName);
+        if (!temp) { 
+            cout << "File not found.\n"; 
+            return; 
+        }
+        
+        // Save the current state for undo before editing
+        undoStack.push({Operation::editFile, repo->repoName, fileName, temp->blob});
+        
+        // Perform the operation
+        repo->getCurrentFiles()->put(fileName, newContent);
+        
+        // Add to commit history for current branch
+        Branch* currentBranch = repo->branchManager.getCurrentBranch();
+        if (currentBranch) {
+            repo->branchManager.commit(currentBranch, "Edited File: " + fileName, currentUser, when);
+        }
+        // Also add to global commit history for tracking
+        commits.addCommit("Edited File: " + fileName + " in branch " + repo->branchManager.currentBranch.str(), currentUser, when);
+        cout << "File edited successfully in branch " << repo->branchManager.currentBranch << ".\n";
+    }
+
+    void showFiles(Repository* repo) {
+        FileTree* files = repo->getCurrentFiles();
+        if (!files || files->empty()) { 
+            cout << "No files in branch " << repo->branchManager.currentBranch << ".\n"; 
+            return; 
+        }
+        cout << "\nFiles in " << repo->repoName << " (branch: " << repo->branchManager.currentBranch << "):\n";
+        files->forEach([](const File& f) { cout << "- " << f.name << endl; });
+    }
+
+    // -------------------- Branch Operations --------------------
+    void createBranch(Repository* repo, string baseBranch, string newBranch, int64_t when = time(0)) {
+        if (repo->branchManager.createBranch(baseBranch, newBranch)) {
+            // Add commit to the new branch
+            Branch* newBranchPtr = repo->branchManager.findBranch(newBranch);
+            if (newBranchPtr) {
+                repo->branchManager.commit(newBranchPtr, "Created branch: " + newBranch + " from " + baseBranch, currentUser, when);
+            }
+            // Add to global commit history
+            commits.addCommit("Created branch: " + newBranch + " from " + baseBranch, currentUser, when);
+            cout << "Branch '" << newBranch << "' created from '" << baseBranch << "'.\n";
+        } else {
+            cout << "Failed to create branch. Branch may already exist or base branch not found.\n";
+        }
+    }
+    
+    void switchBranch(Repository* repo, string branchName, int64_t when = time(0)) {
+        if (repo->branchManager.switchBranch(branchName)) {
+            commits.addCommit("Switched to branch: " + branchName, currentUser, when);
+            cout << "Switched to branch '" << branchName << "'.\n";
+        } else {
+            cout << "Branch '" << branchName << "' not found.\n";
+        }
+    }
+    
+    MergeResult mergeBranch(Repository* repo, string sourceBranch, string targetBranch, int64_t when = time(0)) {
+        MergeResult merge = repo->branchManager.mergeBranch(sourceBranch, targetBranch, when);
+        if (merge.merged) {
+            commits.addCommit("Merged branch " + sourceBranch + " into " + targetBranch, currentUser, when);
+            cout << "Successfully merged '" << sourceBranch << "' into '" << targetBranch << "'.\n";
+        } else {
+            cout << "Failed to merge branches. One or both branches may not exist.\n";
+        }
+        return merge;
+    }
+    
+    void listBranches(Repository* repo) {
+        vector<string> branches = repo->branchManager.listBranches();
+        cout << "\nBranches in " << repo->repoName << ":\n";
+        for (const string& branch : branches) {
+            if (branch == repo->branchManager.currentBranch.str()) {
+                cout << "* " << branch << " (current)\n";
+            } else {
+                cout << "  " << branch << "\n";
+            }
+        }
+    }
+    
+    // Test function to verify branch isolation
+    void testBranchIsolation(Repository* repo) {
+        if (repo->branchManager.branchMap.size() < 2) {
+            cout << "Need at least 2 branches to test isolation.\n";
+            return;
+        }
+        
+        cout << "\n=== Testing Branch Isolation ===\n";
+        
+        // Get two different branches
+        vector<Branch*> branches = repo->branchManager.sortedBranches();
+        Branch* branch1 = branches[0];
+        Branch* branch2 = branches[1];
+        
+        cout << "Branch 1: " << branch1->branchName << "\n";
+        cout << "Branch 2: " << branch2->branchName << "\n";
+        
+        // Count files in each branch
+        size_t files1 = branch1->files.size(), files2 = branch2->files.size();
+        
+        cout << "Files in " << branch1->branchName << ": " << files1 << "\n";
+        cout << "Files in " << branch2->branchName << ": " << files2 << "\n";
+        
+        // Test isolation by editing a file in branch1 and checking branch2
+        if (!branch1->files.empty()) {
+            FileTree original = branch1->files;
+            string testName = original.root->file->name;
+            branch1->files.put(testName, "ISOLATION_TEST_CONTENT");
+            
+            bool isolated = true;
+            const File* other = branch2->files.find(testName);
+            if (other) {
+                isolated = (other->content() != "ISOLATION_TEST_CONTENT");
+            }
+            
+            // Restore original content
+            branch1->files = original;
+            
+            cout << "Branch isolation working: " << (isolated ? "YES" : "NO") << "\n";
+        } else {
+            cout << "No files to test isolation with.\n";
+        }
+        
+        cout << "=== Branch Isolation Test Complete ===\n\n";
+    }
+    
+    // Test function to verify merge functionality
+    void testMergeFunctionality(Repository* repo) {
+        if (repo->branchManager.branchMap.size() < 2) {
+            cout << "Need at least 2 branches to test merge functionality.\n";
+            return;
+        }
+        
+        cout << "\n=== Testing Merge Functionality ===\n";
+        
+        // Get branch names
+        vector<string> branches = repo->branchManager.listBranches();
+        if (branches.size() < 2) return;
+        
+        string branch1 = branches[0];
+        string branch2 = branches[1];
+        
+        cout << "Testing merge from '" << branch1 << "' to '" << branch2 << "'\n";
+        
+        // Count files and commits before merge
+        Branch* b1 = repo->branchManager.findBranch(branch1);
+        Branch* b2 = repo->branchManager.findBranch(branch2);
+        
+        size_t files1Before = b1->files.size(), files2Before = b2->files.size();
+        size_t commits1Before = repo->branchManager.branchHistory(b1).size();
+        size_t commits2Before = repo->branchManager.branchHistory(b2).size();
+        
+        cout << "Before merge:\n";
+        cout << "  " << branch1 << ": " << files1Before << " files, " << commits1Before << " commits\n";
+        cout << "  " << branch2 << ": " << files2Before << " files, " << commits2Before << " commits\n";
+        
+        // Perform merge
+        bool mergeSuccess = repo->branchManager.mergeBranch(branch1, branch2).merged;
+        
+        if (mergeSuccess) {
+            // Count files and commits after merge
+            size_t files2After = b2->files.size();
+            size_t commits2After = repo->branchManager.branchHistory(b2).size();
+            
+            cout << "After merge:\n";
+            cout << "  " << branch2 << ": " << files2After << " files, " << commits2After << " commits\n";
+            cout << "Merge test: " << (files2After >= files2Before && commits2After > commits2Before ? "PASSED" : "FAILED") << "\n";
+        } else {
+            cout << "Merge failed!\n";
+        }
+        
+        cout << "=== Merge Functionality Test Complete ===\n\n";
+    }
+
+    // -------------------- Task Operations --------------------
+    void addTask(Repository* repo, string task, int64_t when = time(0)) {
+        if (!repo->tasks.push(task)) { cout << "Task queue is full (" << repo->tasks.capacity() << " tasks).\n"; return; }
+        commits.addCommit("Added Task: " + task, currentUser, when);
+        undoStack.push({Operation::removeTask, repo->repoName, "", task});
+        cout << "Task added.\n";
+    }
+
+    void removeTask(Repository* repo, int64_t when = time(0)) {
+        string t;
+        if (!repo->tasks.pop(t)) { cout << "No tasks.\n"; return; }
+        commits.addCommit("Removed Task: " + t, currentUser, when);
+        undoStack.push({Operation::addTask, repo->repoName, "", t});
+        cout << "Task removed.\n";
+    }
+
+    void viewTasks(Repository* repo) {
+        if (repo->tasks.empty()) { cout << "No tasks.\n"; return; }
+        cout << "\nTasks in " << repo->repoName << ":\n";
+        for (const string& task : repo->tasks.pending()) cout << "- " << task << endl;
+    }
+
+    // -------------------- Undo/Redo --------------------
+    void undo(int64_t when = time(0)) {
+        if (undoStack.empty()) { 
+            cout << "Nothing to undo.\n"; 
+            return; 
+        }
+        
+        // Get the operation to undo
+        Operation op = undoStack.top(); 
+        undoStack.pop();
+        
+        // Push to redo stack before performing the operation
+        redoStack.push(op);
+        
+        // Find the repository if needed
+        Repository* r = findRepo(op.repoName);
+        
+        // Perform the inverse operation without pushing to undo stack
+        if (op.type == Operation::createFile && r) {
+            // To undo create, we need to delete the file
+            if (r->getCurrentFiles()->erase(op.fileName)) {
+                commits.addCommit("Undo: Deleted file " + op.fileName, currentUser, when);
+            }
+        }
+        else if (op.type == Operation::deleteFile && r) {
+            // To undo delete, we need to create the file with its content
+            r->getCurrentFiles()->put(op.fileName, op.content);
+            commits.addCommit("Undo: Restored file " + op.fileName, currentUser, when);
+        }
+        else if (op.type == Operation::editFile && r) {
+            // To undo edit, we need to restore the old content
+            const File* temp = findFile(r, op.fileName);
+            if (temp) {
+                BlobRef currentContent = temp->blob;
+                r->getCurrentFiles()->put(op.fileName, op.content);
+                commits.addCommit("Undo: Reverted changes to " + op.fileName, currentUser, when);
+                // Update the redo stack with the current content for redo
+                redoStack.setTopContent(currentContent);
+            }
+        }
+        else {
+            // For other operation types, use the original logic
+            if (op.type == Operation::deleteRepo) deleteRepository(op.repoName, when);
+            else if (op.type == Operation::createRepo) createRepository(op.repoName, "", false, when);
+            else if (op.type == Operation::addTask && r) addTask(r, op.text(), when);
+            else if (op.type == Operation::removeTask && r) removeTask(r, when);
+        }
+        
+        cout << "Undo performed: " << op.type << " on " << op.fileName << "\n";
+    }
+
+    void redo(int64_t when = time(0)) {
+        if (redoStack.empty()) { 
+            cout << "Nothing to redo.\n"; 
+            return; 
+        }
+        
+        // Get the operation to redo
+        Operation op = redoStack.top();
+        redoStack.pop();
+        
+        // Push to undo stack before performing the operation
+        undoStack.push(op);
+        
+        // Find the repository if needed
+        Repository* r = findRepo(op.repoName);
+        
+        // Perform the operation without pushing to redo stack
+        if (op.type == Operation::createFile && r) {
+            r->getCurrentFiles()->put(op.fileName, op.content);
+            commits.addCommit("Redo: Created file " + op.fileName, currentUser, when);
+        }
+        else if (op.type == Operation::deleteFile && r) {
+            if (r->getCurrentFiles()->erase(op.fileName)) {
+                commits.addCommit("Redo: Deleted file " + op.fileName, currentUser, when);
+            }
+        }
+        else if (op.type == Operation::editFile && r) {
+            const File* temp = findFile(r, op.fileName);
+            if (temp) {
+                BlobRef oldContent = temp->blob;
+                r->getCurrentFiles()->put(op.fileName, op.content);
+                commits.addCommit("Redo: Edited file " + op.fileName, currentUser, when);
+                // Update the undo stack with the old content for undo
+                undoStack.setTopContent(oldContent);
+            }
+        }
+        else {
+            // For other operation types, use the original logic
+            if (op.type == Operation::deleteRepo) deleteRepository(op.repoName, when);
+            else if (op.type == Operation::createRepo) createRepository(op.repoName, "", false, when);
+            else if (op.type == Operation::addTask && r) addTask(r, op.text(), when);
+            else if (op.type == Operation::removeTask && r) removeTask(r, when);
+        }
+        
+        cout << "Redo performed: " << op.type << " on " << op.fileName << "\n";
+    }
+
+    void showHistory() { commits.showCommits(); }
+
+    // -------------------- Search Methods --------------------
+    vector<string> searchRepositories(const string& term) {
+        vector<string> results;
+        repoIndex.searchContaining(term, results);
+        return results;
+    }
+    
+    // Autocomplete: repository names starting with prefix, via a B+ tree range scan
+    vector<string> searchRepositoriesByPrefix(const string& prefix, size_t limit = 0) {
+        vector<string> results;
+        repoIndex.scanPrefix(prefix, results, limit);
+        return results;
+    }
+    
+    vector<string> searchInRepository(Repository* repo, const string& term, bool searchContent = false) {
+        vector<string> results;
+        if (!repo) return results;
+        
+        FileTree* files = repo->getCurrentFiles();
+        if (searchContent && term.size() >= 3) {
+            // Only files holding every trigram of the term can match; verify those
+            for (const string& name : files->contentIndex().candidates(term)) {
+                if (TextSearch::containsIgnoreCase(files->find(name)->content(), term)) {
+                    results.push_back(name);
+                }
+            }
+            sort(results.begin(), results.end());
+            return results;
+        }
+        
+        files->forEach([&](const File& file) {
+            // Search in file content or in the filename
+            const string& text = searchContent ? file.content() : file.name;
+            if (TextSearch::containsIgnoreCase(text, term)) {
+                results.push_back(file.name);
+            }
+        });
+        return results;
+    }
+    
+    // -------------------- Web Interface Methods --------------------
+    // Fields of a repository in listings; GET /api/repositories?fields= picks a subset
+    enum RepoField {
+        kFieldName = 1, kFieldDescription = 2, kFieldCreatedDate = 4, kFieldPrivate = 8,
+        kFieldCurrentBranch = 16, kFieldBranches = 32, kFieldFiles = 64, kFieldContent = 128,
+        kFieldCommits = 256, kAllFields = 511
+    };
+
+    // Parse a list such as "name,description,files". The name is always included
+    // since it is the pagination cursor; "content" adds file contents to "files".
+    static unsigned parseFields(const string& list) {
+        static const pair<const char*, unsigned> names[] = {
+            {"name", kFieldName}, {"description", kFieldDescription}, {"createdDate", kFieldCreatedDate},
+            {"isPrivate", kFieldPrivate}, {"currentBranch", kFieldCurrentBranch}, {"branches", kFieldBranches},
+            {"files", kFieldFiles}, {"content", kFieldFiles | kFieldContent}, {"commits", kFieldCommits}
+        };
+        unsigned fields = kFieldName;
+        stringstream items(list);
+        for (string item; getline(items, item, ',');) {
+            for (const auto& field : names) {
+                if (item == field.first) fields |= field.second;
+            }
+        }
+        return fields;
+    }
+
+    // Write one repository with the requested fields. Repositories still in the
+    // snapshot are only paged in when a field needs their contents.
+    void writeRepository(JsonWriter& json, Repository* temp, unsigned fields) {
+        if (needsContents(fields)) pageIn(temp);
+        BranchManager& bm = temp->branchManager;
+        bool firstKey = true;
+        auto key = [&](const char* name) -> JsonWriter& {
+            json.raw(firstKey ? "{\"" : ",\"").raw(name).raw("\":");
+            firstKey = false;
+            return json;
+        };
+        if (fields & kFieldName) key("name").str(temp->repoName);
+        if (fields & kFieldDescription) key("description").str(temp->description.empty() ? "Repository" : temp->description);
+        if (fields & kFieldCreatedDate) key("createdDate").str(getCurrentDate());
+        if (fields & kFieldPrivate) key("isPrivate").boolean(temp->isPrivate);
+        if (fields & kFieldCurrentBranch) key("currentBranch").str(bm.currentBranch);
+        if (fields & kFieldBranches) bm.writeBranches(key("branches"));
+        if (fields & kFieldFiles) {
+            key("files").raw("[");
+            bool firstFile = true;
+            temp->getCurrentFiles()->forEach([&](const File& file) {
+                const string& content = file.content();
+                if (!firstFile) json.raw(",");
+                json.raw("{\"name\":").str(file.name).raw(",\"info\":");
+                if (content.length() > 50) json.str(content.substr(0, 50) + "...");
+                else json.str(content);
+                json.raw(",\"date\":\"a few seconds ago\"");
+                if (fields & kFieldContent) json.raw(",\"content\":").str(content);
+                json.raw("}");
+                firstFile = false;
+            });
+            json.raw("]");
+        }
+        if (fields & kFieldCommits) {
+            key("commits").raw("[");
+            // Get commits from current branch
+            Branch* currentBranch = bm.getCurrentBranch();
+            if (currentBranch && currentBranch->head >= 0) {
+                bool firstCommit = true;
+                for (const CommitNode* commitTemp : bm.branchHistory(currentBranch)) {
+                    if (!firstCommit) json.raw(",");
+                    json.raw("{\"message\":").str(commitTemp->action())
+                        .raw(",\"author\":").str(commitTemp->author)
+                        .raw(",\"date\":").str(commitTemp->date()).raw("}");
+                    firstCommit = false;
+                }
+            } else {
+                // Fallback commit if no branch commits exist
+                json.raw("{\"message\":\"Repository created\",\"author\":").str(currentUser)
+                    .raw(",\"date\":").str(getCurrentDate()).raw("}");
+            }
+            json.raw("]");
+        }
+        json.raw("}");
+    }
+
+    // Stream every repository, newest first, with the requested fields
+    void writeJSON(JsonWriter& json, unsigned fields = kAllFields) {
+        json.raw("{\"repositories\":[");
+        for (Repository* temp = head; temp; temp = temp->next) {
+            if (temp != head) json.raw(",");
+            writeRepository(json, temp, fields);
+        }
+        json.raw("]}");
+    }
+
+    // The same listing for a web request: the repositories come from a catalog
+    // and each is rendered under its shared lock
+    void writeJSON(JsonWriter& json, const RepoCatalog& catalog, unsigned fields) {
+        json.raw("{\"repositories\":[");
+        for (size_t i = 0; i < catalog.order.size(); i++) {
+            if (i > 0) json.raw(",");
+            shared_lock<shared_mutex> reader = lockForReading(catalog.order[i], needsContents(fields));
+            writeRepository(json, catalog.order[i], fields);
+        }
+        json.raw("]}");
+    }
+
+    static bool needsContents(unsigned fields) {
+        return (fields & (kFieldCurrentBranch | kFieldBranches | kFieldFiles | kFieldCommits)) != 0;
+    }
+
+    // One page of repositories in name order (case-insensitive), starting after
+    // the cursor name. nextCursor is the name to pass for the following page, or
+    // null on the last page. Costs O(log n + limit) whatever the total count.
+    void writePage(JsonWriter& json, const RepoCatalog& catalog, const string& cursor, size_t limit, unsigned fields) {
+        vector<string> names;
+        catalog.index.scanAfter(cursor, names, limit + 1);
+        bool more = names.size() > limit;
+        if (more) names.pop_back();
+        json.raw("{\"repositories\":[");
+        for (size_t i = 0; i < names.size(); i++) {
+            if (i > 0) json.raw(",");
+            RepoRef repo = catalog.find(names[i]);
+            shared_lock<shared_mutex> reader = lockForReading(repo.get(), needsContents(fields));
+            writeRepository(json, repo.get(), fields);
         }
-        // Also add to global commit history for tracking
-        commits.addCommit("Created File: " + fileName + " in branch " + repo->branchManager.currentBranch, currentUser);
-        cout << "File created successfully in branch " << repo->branchManager.currentBranch << ".\n";
+        json.raw("],\"nextCursor\":");
+        if (more) json.str(names.back());
+        else json.raw("null");
+        json.raw("}");
     }
 
-    void deleteFile(Repository* repo, string fileName) {
-        File* temp = repo->getCurrentFiles(), *prev = NULL;
-        while (temp && temp->name != fileName) { prev = temp; temp = temp->next; }
-        if (!temp) { 
-            cout << "File not found.\n"; 
-            return; 
+    // Value of key in a query string such as "limit=20&cursor=abc", or def if absent
+    static string queryValue(const string& query, const string& key, const string& def = "") {
+        size_t pos = 0;
+        while (pos <= query.size()) {
+            size_t end = query.find('&', pos);
+            if (end == string::npos) end = query.size();
+            size_t eq = query.find('=', pos);
+            if (eq < end && query.compare(pos, eq - pos, key) == 0) return query.substr(eq + 1, end - eq - 1);
+            pos = end + 1;
         }
-        
-        // Save the current state for undo before deleting
-        undoStack.push({"deleteFile", repo->repoName, temp->name, temp->content});
-        
-        // Perform the operation
-        if (prev) 
-            prev->next = temp->next; 
-        else 
-            repo->setCurrentFiles(temp->next);
-            
-        // Add to commit history for current branch
-        Branch* currentBranch = repo->branchManager.getCurrentBranch();
-        if (currentBranch) {
-            currentBranch->commits.addCommit("Deleted File: " + fileName, currentUser);
+        return def;
+    }
+
+    string toJSON() {
+        string out;
+        JsonWriter json(JsonWriter::into(out));
+        writeJSON(json);
+        json.flush();
+        return out;
+    }
+
+    string getCurrentDate() {
+        return formatTime(time(0));
+    }
+
+    bool saveToFile() {
+        static const size_t series = Metrics::instance().addSeries(Metrics::kPersist, "saveToFile");
+        Metrics::Timer timer(series);
+        FILE* file = fopen("data.json", "wb");
+        if (!file) { cout << "Could not write data.json\n"; timer.error = true; return false; }
+        {
+            JsonWriter json(JsonWriter::into(file));
+            writeJSON(json);
         }
-        // Also add to global commit history for tracking
-        commits.addCommit("Deleted File: " + fileName + " in branch " + repo->branchManager.currentBranch, currentUser);
-        
-        // Delete the file
-        delete temp;
-        cout << "File deleted successfully from branch " << repo->branchManager.currentBranch << ".\n";
+        long written = ftell(file);
+        timer.bytes = written > 0 ? (uint64_t)written : 0;
+        timer.error = ferror(file) != 0;
+        if (fclose(file) != 0) timer.error = true;
+        return !timer.error;
     }
 
-    void editFile(Repository* repo, string fileName, string newContent) {
-        File* temp = findFile(repo, fileName);
-        if (!temp) { 
-            cout << "File not found.\n"; 
-            return; 
+    // -------------------- Persistence --------------------
+    // Apply one logged operation. Records are the API-level mutations, so replaying
+    // them through the same methods rebuilds the same files, commits and undo/redo stacks.
+    // Records that make commits end with the time they were made, which goes into
+    // the commit hashes; records written before that replay at the current time.
+    void applyOperation(const vector<string>& op) {
+        if (op.empty()) return;
+        const string& type = op[0];
+        Repository* repo = op.size() > 1 ? findRepo(op[1]) : NULL;
+        auto has = [&](size_t fields) { return op.size() == fields || op.size() == fields + 1; };
+        auto when = [&](size_t fields) {
+            return op.size() == fields + 1 ? (int64_t)strtoll(op[fields].c_str(), NULL, 10) : (int64_t)time(0);
+        };
+        if (type == "createRepo" && has(4)) createRepository(op[1], op[2], op[3] == "1", when(4));
+        else if (type == "deleteRepo" && has(2)) deleteRepository(op[1], when(2));
+        else if (type == "editRepo" && has(4) && repo) editRepository(repo, op[2], op[3] == "1", when(4));
+        else if (type == "createFile" && has(4) && repo) createFile(repo, op[2], op[3], when(4));
+        else if (type == "editFile" && has(4) && repo) editFile(repo, op[2], op[3], when(4));
+        else if (type == "deleteFile" && has(3) && repo) deleteFile(repo, op[2], when(3));
+        else if (type == "createBranch" && has(4) && repo) createBranch(repo, op[2], op[3], when(4));
+        else if (type == "switchBranch" && has(3) && repo) switchBranch(repo, op[2], when(3));
+        else if (type == "mergeBranch" && has(4) && repo) mergeBranch(repo, op[2], op[3], when(4));
+        else if (type == "enqueueTask" && op.size() == 3 && repo) repo->tasks.push(op[2]);
+        else if (type == "claimTasks" && op.size() == 3 && repo) {
+            vector<string> claimed;
+            repo->tasks.popBatch(claimed, strtoul(op[2].c_str(), NULL, 10));
         }
-        
-        // Save the current state for undo before editing
-        string oldContent = temp->content;
-        undoStack.push({"editFile", repo->repoName, fileName, oldContent});
-        
-        // Perform the operation
-        temp->content = newContent;
-        
-        // Add to commit history for current branch
-        Branch* currentBranch = repo->branchManager.getCurrentBranch();
-        if (currentBranch) {
-            currentBranch->commits.addCommit("Edited File: " + fileName, currentUser);
+        else if (type == "undo" && has(1)) undo(when(1));
+        else if (type == "redo" && has(1)) redo(when(1));
+        else if (type == "historyLimits" && op.size() == 3) setHistoryLimits(strtoull(op[1].c_str(), NULL, 10), strtoull(op[2].c_str(), NULL, 10));
+    }
+
+    // Append a mutation that has just been applied to the log. Call it while still
+    // holding the locks that ordered the mutation, so records for one repository
+    // (and for the undo/redo stacks) are in the order they were applied.
+    // Returns the sequence number to pass to commit().
+    uint64_t journal(const vector<string_view>& op) {
+        return storeOpen ? opLog.append(op) : 0;
+    }
+
+    // Wait until a journaled mutation is durable. Call it with no locks held:
+    // concurrent requests share one fsync while they wait here.
+    // Returns false if the mutation could not be written; routes answer 500.
+    bool commit(uint64_t seq) {
+        if (storeDamaged) return false;
+        if (storeOpen) {
+            {
+                static const size_t series = Metrics::instance().addSeries(Metrics::kPersist, "walSync");
+                Metrics::Timer timer(series);
+                timer.error = !opLog.sync(seq);
+                if (timer.error) return false;
+            }
+            if (opLog.size() >= kCompactBytes) compact(kCompactBytes);
+        } else if (storeLoaded) {
+            lock_guard<mutex> repos(catalogLock);
+            vector<unique_lock<shared_mutex>> writers = lockAllRepositories();
+            return saveToFile();
         }
-        // Also add to global commit history for tracking
-        commits.addCommit("Edited File: " + fileName + " in branch " + repo->branchManager.currentBranch, currentUser);
-        cout << "File edited successfully in branch " << repo->branchManager.currentBranch << ".\n";
+        return true;
     }
 
-    void showFiles(Repository* repo) {
-        File* files = repo->getCurrentFiles();
-        if (!files) { 
-            cout << "No files in branch " << repo->branchManager.currentBranch << ".\n"; 
-            return; 
+    // Exclusive locks on every repository, in list order, for work that needs
+    // one consistent state of all of them. The caller holds catalogLock.
+    vector<unique_lock<shared_mutex>> lockAllRepositories() {
+        vector<unique_lock<shared_mutex>> writers;
+        for (Repository* r = head; r; r = r->next) writers.emplace_back(r->lock);
+        return writers;
+    }
+
+    // Fold the log into a fresh snapshot and empty it. The snapshot remembers the
+    // last record it covers and replay skips those, so a crash between writing
+    // the snapshot and truncating the log loses and repeats nothing. Every lock is
+    // held meanwhile, so no record is appended between the cut and the truncation.
+    // Skipped if the log has shrunk below minBytes (another request compacted it).
+    void compact(size_t minBytes = 0) {
+        lock_guard<mutex> repos(catalogLock);
+        vector<unique_lock<shared_mutex>> writers = lockAllRepositories();
+        lock_guard<mutex> history(journalLock);
+        if (opLog.size() < minBytes) return;
+        uint64_t seq = opLog.lastSequence();
+        if (!opLog.sync(seq) || !writeSnapshot(kSnapshotPath, seq)) return;
+        opLog.truncate();
+        saveToFile();
+    }
+
+    // Encode one repository's contents as a snapshot section
+    static string encodeRepository(Repository* r) {
+        BranchManager& bm = r->branchManager;
+        ByteWriter blobs, nodes, rest;
+        uint32_t blobCount = 0, nodeCount = 0;
+        unordered_map<const Blob*, uint32_t> blobIds;
+        unordered_map<const FileNode*, uint32_t> nodeIds;
+        function<uint32_t(const FileNode*)> writeNode = [&](const FileNode* node) -> uint32_t {
+            if (!node) return 0;
+            auto known = nodeIds.find(node);
+            if (known != nodeIds.end()) return known->second;
+            uint32_t left = writeNode(node->left.get());
+            uint32_t right = writeNode(node->right.get());
+            const Blob* blob = node->file->blob.get();
+            auto blobId = blobIds.find(blob);
+            if (blobId == blobIds.end()) {
+                blobId = blobIds.emplace(blob, ++blobCount).first;
+                blobs.str(blob->data);
+            }
+            nodes.str(node->file->name);
+            nodes.u32(blobId->second);
+            nodes.u32(left);
+            nodes.u32(right);
+            return nodeIds[node] = ++nodeCount;
+        };
+
+        rest.u32((uint32_t)bm.graph.commits.size());
+        for (const CommitNode& c : bm.graph.commits) {
+            rest.u64(c.hash);
+            rest.u32((uint32_t)c.parents.size());
+            for (int p : c.parents) rest.u32((uint32_t)p);
+            rest.str(c.action());
+            rest.str(c.author);
+            rest.u64((uint64_t)c.timestamp);
+            rest.u32(writeNode(c.tree.root.get()));
         }
-        File* temp = files;
-        cout << "\nFiles in " << repo->repoName << " (branch: " << repo->branchManager.currentBranch << "):\n";
-        while (temp) { cout << "- " << temp->name << endl; temp = temp->next; }
+        vector<Branch*> branches = bm.sortedBranches();
+        rest.u32((uint32_t)branches.size());
+        for (Branch* b : branches) {
+            rest.str(b->branchName);
+            rest.str(b->parentBranch);
+            rest.u32((uint32_t)b->head);   // -1 round-trips through the cast
+            rest.u32(writeNode(b->files.root.get()));
+        }
+        rest.str(bm.currentBranch);
+        vector<string> tasks = r->tasks.pending();
+        rest.u32((uint32_t)tasks.size());
+        for (const string& task : tasks) rest.str(task);
+
+        ByteWriter section;
+        section.u32(blobCount);
+        section.out += blobs.out;
+        section.u32(nodeCount);
+        section.out += nodes.out;
+        section.out += rest.out;
+        return section.out;
     }
 
-    // -------------------- Branch Operations --------------------
-    void createBranch(Repository* repo, string baseBranch, string newBranch) {
-        if (repo->branchManager.createBranch(baseBranch, newBranch)) {
-            // Add commit to the new branch
-            Branch* newBranchPtr = repo->branchManager.branchMap[newBranch];
-            if (newBranchPtr) {
-                newBranchPtr->commits.addCommit("Created branch: " + newBranch + " from " + baseBranch, currentUser);
+    // Decode a section written by encodeRepository() into a repository that has
+    // only its main branch. Nothing is changed unless the whole section is valid.
+    static bool decodeRepository(Repository* r, const char* data, size_t length, uint32_t version) {
+        ByteReader in(data, length);
+        vector<BlobRef> blobs(1);
+        for (uint32_t n = in.u32(); in.ok && n > 0; n--) blobs.push_back(BlobStore::instance().intern(in.str()));
+
+        vector<FileNodeRef> nodes(1);
+        auto nodeAt = [&](uint32_t id) {
+            if (id >= nodes.size()) { in.ok = false; return FileNodeRef(); }
+            return nodes[id];
+        };
+        for (uint32_t n = in.u32(); in.ok && n > 0; n--) {
+            string name = in.str();
+            uint32_t blob = in.u32();
+            FileNodeRef left = nodeAt(in.u32());
+            FileNodeRef right = nodeAt(in.u32());
+            if (!in.ok || blob == 0 || blob >= blobs.size()) return false;
+            FileRef file = FileTree::makeFile(&r->nodes, name, blobs[blob]);
+            nodes.push_back(FileTree::makeNode(&r->nodes, file, FileTree::priorityOf(name), left, right));
+        }
+
+        vector<CommitNode> commits;
+        for (uint32_t n = in.u32(); in.ok && n > 0; n--) {
+            CommitNode c{in.u64(), {}, 0, "", Symbol(), 0, FileTree()};
+            for (uint32_t k = in.u32(); in.ok && k > 0; k--) {
+                uint32_t p = in.u32();
+                if (p >= commits.size()) return false;  // Parents always come first
+                c.parents.push_back((int)p);
             }
-            // Add to global commit history
-            commits.addCommit("Created branch: " + newBranch + " from " + baseBranch, currentUser);
-            cout << "Branch '" << newBranch << "' created from '" << baseBranch << "'.\n";
-        } else {
-            cout << "Failed to create branch. Branch may already exist or base branch not found.\n";
+            string action = in.str();
+            c.verb = actionVerbOf(action);
+            c.detail = action.substr(strlen(kActionVerbs[c.verb]));
+            c.author = Symbol(in.str());
+            c.timestamp = version >= 3 ? (int64_t)in.u64() : (int64_t)parseTime(in.str());
+            c.tree.root = nodeAt(in.u32());
+            commits.push_back(move(c));
         }
+
+        struct BranchRecord { string name, parent; int head; FileNodeRef files; };
+        vector<BranchRecord> branches;
+        for (uint32_t n = in.u32(); in.ok && n > 0; n--) {
+            BranchRecord b;
+            b.name = in.str();
+            b.parent = in.str();
+            b.head = (int)in.u32();
+            b.files = nodeAt(in.u32());
+            if (b.head < -1 || b.head >= (int)commits.size()) return false;
+            branches.push_back(move(b));
+        }
+        string currentBranch = in.str();
+        vector<string> tasks;
+        for (uint32_t n = in.u32(); in.ok && n > 0; n--) tasks.push_back(in.str());
+        if (!in.ok || in.pos != in.end) return false;
+
+        BranchManager& bm = r->branchManager;
+        for (CommitNode& c : commits) {
+            bm.graph.byHash[c.hash] = (int)bm.graph.commits.size();
+            bm.graph.commits.push_back(move(c));
+        }
+        for (BranchRecord& record : branches) {
+            Branch* b = record.name == "main" ? bm.root : new Branch(record.name, record.parent);
+            b->head = record.head;
+            b->files.root = record.files;
+            b->files.pool = &r->nodes;
+            bm.branchMap[record.name] = b;
+        }
+        // Rebuild the branch hierarchy from the parent names
+        for (Branch* b : bm.sortedBranches()) {
+            auto parent = bm.branchMap.find(b->parentBranch);
+            if (b->parentBranch.empty() || parent == bm.branchMap.end()) continue;
+            b->parent = parent->second;
+            parent->second->children.push_back(b);
+        }
+        bm.currentBranch = currentBranch;
+        for (string& task : tasks) r->tasks.push(task);
+        return true;
     }
-    
-    void switchBranch(Repository* repo, string branchName) {
-        if (repo->branchManager.switchBranch(branchName)) {
-            commits.addCommit("Switched to branch: " + branchName, currentUser);
-            cout << "Switched to branch '" << branchName << "'.\n";
-        } else {
-            cout << "Branch '" << branchName << "' not found.\n";
+
+    // Decode a repository's snapshot section the first time it is needed
+    void pageIn(Repository* r) {
+        if (!r || !r->image) return;
+        shared_ptr<const SnapshotImage> image;
+        image.swap(r->image);
+        const char* data = image->data() + r->imageOffset;
+        if (LogRecord::checksum(0, data, r->imageLength) != r->imageChecksum ||
+            !decodeRepository(r, data, r->imageLength, image->version())) {
+            storeDamaged = true;
+            cout << "Snapshot data for repository '" << r->repoName << "' is damaged; changes are no longer saved"
+                 << " and " << kSnapshotPath << " is left as it is.\n";
         }
     }
-    
-    void mergeBranch(Repository* repo, string sourceBranch, string targetBranch) {
-        if (repo->branchManager.mergeBranch(sourceBranch, targetBranch)) {
-            commits.addCommit("Merged branch " + sourceBranch + " into " + targetBranch, currentUser);
-            cout << "Successfully merged '" << sourceBranch << "' into '" << targetBranch << "'.\n";
+
+    // Write the full state to a temporary file and rename it into place.
+    // Repositories that were never paged in are copied straight from the old image,
+    // unless it has an older format version.
+    bool writeSnapshot(const string& path, uint64_t seq) {
+        static const size_t series = Metrics::instance().addSeries(Metrics::kPersist, "writeSnapshot");
+        Metrics::Timer timer(series);
+        timer.error = true;     // Until the new file is in place
+        if (storeDamaged) return false;
+        string temp = path + ".tmp";
+        FILE* out = fopen(temp.c_str(), "wb");
+        if (!out) { cout << "Could not write " << temp << "\n"; return false; }
+
+        string header(kSnapshotHeaderSize, '\0');
+        fwrite(header.data(), 1, header.size(), out);
+        uint64_t offset = kSnapshotHeaderSize;
+        uint32_t count = 0;
+        ByteWriter directory;
+
+        // Tail first, so that loading the directory in order restores the list order
+        Repository* tail = head;
+        while (tail && tail->next) tail = tail->next;
+        for (Repository* r = tail; r; r = r->prev) {
+            string encoded;
+            const char* section;
+            uint64_t length;
+            uint32_t sum;
+            if (r->image && r->image->version() != kSnapshotVersion) pageIn(r);
+            if (r->image) {
+                section = r->image->data() + r->imageOffset;
+                length = r->imageLength;
+                sum = r->imageChecksum;
+            } else {
+                encoded = encodeRepository(r);
+                section = encoded.data();
+                length = encoded.size();
+                sum = LogRecord::checksum(0, section, length);
+            }
+            fwrite(section, 1, length, out);
+            directory.str(r->repoName);
+            directory.str(r->description);
+            directory.u8(r->isPrivate ? 1 : 0);
+            directory.u64(offset);
+            directory.u64(length);
+            directory.u32(sum);
+            offset += length;
+            count++;
+        }
+        unordered_map<string, BlobRef> previous;
+        for (int s = 0; s < 2; s++) {
+            const OperationHistory& ops = s == 0 ? undoStack : redoStack;
+            directory.u32((uint32_t)ops.size());
+            for (size_t i = 0; i < ops.size(); i++) {
+                const Operation& op = ops.at(i);
+                directory.str(op.type);
+                directory.str(op.repoName);
+                directory.str(op.fileName);
+                writeHistoryText(directory, op, previous);
+            }
+        }
+        directory.u64(undoStack.operationLimit());
+        directory.u64(undoStack.byteLimit());
+        fwrite(directory.out.data(), 1, directory.out.size(), out);
+
+        ByteWriter h;
+        h.out.append(kSnapshotMagic, sizeof(kSnapshotMagic));
+        h.u32(kSnapshotVersion);
+        h.u32(count);
+        h.u64(seq);
+        h.u64(offset);
+        h.u64(directory.out.size());
+        h.u32(LogRecord::checksum(0, directory.out.data(), directory.out.size()));
+        h.u32(0);
+        fseek(out, 0, SEEK_SET);
+        fwrite(h.out.data(), 1, h.out.size(), out);
+
+        bool ok = !ferror(out);
+        syncToDisk(out);
+        fclose(out);
+        if (storeDamaged) {     // A section paged in above was damaged
+            remove(temp.c_str());
+            return false;
+        }
+        if (!ok) { cout << "Could not write " << temp << "\n"; return false; }
+#ifdef _WIN32
+        remove(path.c_str());   // rename() does not replace an existing file on Windows
+#endif
+        timer.bytes = offset + directory.out.size();
+        timer.error = rename(temp.c_str(), path.c_str()) != 0;
+        return !timer.error;
+    }
+
+    // Texts shorter than this are written in full; a delta would save little
+    static const size_t kMinDeltaBytes = 256;
+
+    // An undo/redo operation's text: u8 0 and the text, or u8 1 and a TextDelta
+    // against the previous text written for the same repository and file
+    static void writeHistoryText(ByteWriter& out, const Operation& op, unordered_map<string, BlobRef>& previous) {
+        string delta;
+        if (!op.fileName.empty()) {
+            BlobRef& base = previous[op.repoName.str() + '\0' + op.fileName];
+            if (base && op.text().size() >= kMinDeltaBytes) delta = TextDelta::encode(base->data, op.text());
+            base = op.content;
+        }
+        if (!delta.empty() && delta.size() < op.text().size()) {
+            out.u8(1);
+            out.str(delta);
         } else {
-            cout << "Failed to merge branches. One or both branches may not exist.\n";
+            out.u8(0);
+            out.str(op.text());
         }
     }
-    
-    void listBranches(Repository* repo) {
-        vector<string> branches = repo->branchManager.listBranches();
-        cout << "\nBranches in " << repo->repoName << ":\n";
-        for (const string& branch : branches) {
-            if (branch == repo->branchManager.currentBranch) {
-                cout << "* " << branch << " (current)\n";
-            } else {
-                cout << "  " << branch << "\n";
+
+    // Version 1 snapshots hold every text in full
+    static bool readHistoryText(ByteReader& in, uint32_t version, Operation& op, unordered_map<string, BlobRef>& previous) {
+        uint8_t encoding = version >= 2 ? in.u8() : 0;
+        string text = in.str();
+        BlobRef* base = op.fileName.empty() ? NULL : &previous[op.repoName.str() + '\0' + op.fileName];
+        if (encoding == 1) {
+            string full;
+            if (!base || !*base || !TextDelta::apply((*base)->data, text, full)) return false;
+            text.swap(full);
+        } else if (encoding != 0) {
+            return false;
+        }
+        op.content = BlobStore::instance().intern(text);
+        if (base) *base = op.content;
+        return in.ok;
+    }
+
+    // Map a snapshot and register its repositories without decoding them.
+    // Returns false, leaving everything untouched, if there is no usable snapshot.
+    bool loadSnapshot(const string& path, uint64_t& seq) {
+        shared_ptr<const SnapshotImage> image = SnapshotImage::open(path);
+        if (!image) return false;
+        ByteReader in(image->data(), image->size());
+        if (!in.need(kSnapshotHeaderSize) || memcmp(in.pos, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+            cout << "Cannot read " << path << ": not a snapshot file\n";
+            storeDamaged = true;
+            return false;
+        }
+        in.pos += sizeof(kSnapshotMagic);
+        uint32_t version = in.u32();
+        if (version == 0 || version > kSnapshotVersion) {
+            cout << "Cannot read " << path << ": unsupported snapshot version " << version << "\n";
+            storeDamaged = true;
+            return false;
+        }
+        uint32_t count = in.u32();
+        uint64_t lastSeq = in.u64();
+        uint64_t dirOffset = in.u64();
+        uint64_t dirLength = in.u64();
+        uint32_t dirSum = in.u32();
+        if (dirOffset < kSnapshotHeaderSize || dirOffset > image->size() || dirLength > image->size() - dirOffset ||
+            LogRecord::checksum(0, image->data() + dirOffset, dirLength) != dirSum) {
+            cout << "Cannot read damaged snapshot " << path << "\n";
+            storeDamaged = true;
+            return false;
+        }
+
+        struct Entry { string name, description; bool isPrivate; uint64_t offset, length; uint32_t sum; };
+        vector<Entry> entries;
+        ByteReader dir(image->data() + dirOffset, dirLength);
+        for (uint32_t i = 0; i < count && dir.ok; i++) {
+            Entry e;
+            e.name = dir.str();
+            e.description = dir.str();
+            e.isPrivate = dir.u8() != 0;
+            e.offset = dir.u64();
+            e.length = dir.u64();
+            e.sum = dir.u32();
+            if (e.offset < kSnapshotHeaderSize || e.offset > dirOffset || e.length > dirOffset - e.offset) dir.ok = false;
+            entries.push_back(move(e));
+        }
+        vector<Operation> stacks[2];
+        unordered_map<string, BlobRef> previous;
+        for (int s = 0; s < 2 && dir.ok; s++) {
+            for (uint32_t n = dir.u32(); dir.ok && n > 0; n--) {
+                Operation op;
+                op.type = dir.str();
+                op.repoName = dir.str();
+                op.fileName = dir.str();
+                if (!readHistoryText(dir, version, op, previous)) dir.ok = false;
+                stacks[s].push_back(move(op));
             }
         }
+        size_t operationLimit = OperationHistory::kDefaultOperations, byteLimit = OperationHistory::kDefaultBytes;
+        if (version >= 2) {
+            operationLimit = (size_t)dir.u64();
+            byteLimit = (size_t)dir.u64();
+        }
+        if (!dir.ok) {
+            cout << "Cannot read damaged snapshot " << path << "\n";
+            storeDamaged = true;
+            return false;
+        }
+
+        for (const Entry& e : entries) {
+            Repository* r = attachRepository(e.name, e.description, e.isPrivate);
+            r->image = image;
+            r->imageOffset = e.offset;
+            r->imageLength = e.length;
+            r->imageChecksum = e.sum;
+        }
+        setHistoryLimits(operationLimit, byteLimit);
+        for (Operation& op : stacks[0]) undoStack.push(move(op));
+        for (Operation& op : stacks[1]) redoStack.push(move(op));
+        seq = lastSeq;
+        return true;
     }
-    
-    // Test function to verify branch isolation
-    void testBranchIsolation(Repository* repo) {
-        if (repo->branchManager.branchMap.size() < 2) {
-            cout << "Need at least 2 branches to test isolation.\n";
-            return;
+
+    // Restore the snapshot, replay the log on top of it and keep the log open for
+    // new mutations. Starts with sample data if there is nothing to restore.
+    // Returns false, having opened nothing, if the snapshot cannot be read: the
+    // log only applies on top of it, so starting empty would drop both.
+    bool loadFromFile() {
+        uint64_t seq = 0;
+        bool restored = loadSnapshot(kSnapshotPath, seq);
+        if (storeDamaged) {
+            cout << "Not opening the store. Repair " << kSnapshotPath << ", or move it and " << kLogPath
+                 << " aside to start empty.\n";
+            return false;
         }
-        
-        cout << "\n=== Testing Branch Isolation ===\n";
-        
-        // Get two different branches
-        auto it = repo->branchManager.branchMap.begin();
-        Branch* branch1 = it->second;
-        ++it;
-        Branch* branch2 = it->second;
-        
-        cout << "Branch 1: " << branch1->branchName << "\n";
-        cout << "Branch 2: " << branch2->branchName << "\n";
-        
-        // Count files in each branch
-        int files1 = 0, files2 = 0;
-        File* temp = branch1->fileHead;
-        while (temp) { files1++; temp = temp->next; }
-        
-        temp = branch2->fileHead;
-        while (temp) { files2++; temp = temp->next; }
-        
-        cout << "Files in " << branch1->branchName << ": " << files1 << "\n";
-        cout << "Files in " << branch2->branchName << ": " << files2 << "\n";
-        
-        // Test isolation by adding a file to branch1 and checking branch2
-        if (branch1->fileHead) {
-            string originalContent = branch1->fileHead->content;
-            branch1->fileHead->content = "ISOLATION_TEST_CONTENT";
-            
-            bool isolated = true;
-            if (branch2->fileHead && branch2->fileHead->name == branch1->fileHead->name) {
-                isolated = (branch2->fileHead->content != "ISOLATION_TEST_CONTENT");
+        storeLoaded = true;
+
+        streambuf* console = cout.rdbuf(NULL);  // Replay quietly
+        size_t replayed = 0;
+        storeOpen = opLog.open(kLogPath, seq, [&](const vector<string>& op) {
+            applyOperation(op);
+            replayed++;
+        });
+        cout.rdbuf(console);
+        cout.clear();
+        if (!storeOpen) cout << "Could not open " << kLogPath << "; falling back to rewriting data.json\n";
+
+        ifstream file("data.json");
+        if (!restored && replayed == 0 && !file.good()) {
+            // Create sample repository with files
+            createRepository("LeetCode");
+            Repository* repo = findRepo("LeetCode");
+            if (repo) {
+                createFile(repo, "LeetCodeSolutions.js", "// JavaScript solutions for LeetCode problems\n\n// Two Sum Problem\nfunction twoSum(nums, target) {\n    const map = new Map();\n    for (let i = 0; i < nums.length; i++) {\n        const complement = target - nums[i];\n        if (map.has(complement)) {\n            return [map.get(complement), i];\n        }\n        map.set(nums[i], i);\n    }\n    return [];\n}");
+                createFile(repo, "README.md", "# LeetCode Solutions\n\nThis repository contains my solutions to various LeetCode problems.\n\n## Structure\n- Each solution includes time and space complexity analysis\n- Solutions are organized by difficulty level\n- Test cases are provided for each problem");
             }
-            
-            // Restore original content
-            branch1->fileHead->content = originalContent;
-            
-            cout << "Branch isolation working: " << (isolated ? "YES" : "NO") << "\n";
-        } else {
-            cout << "No files to test isolation with.\n";
+            compact();
         }
-        
-        cout << "=== Branch Isolation Test Complete ===\n\n";
+        file.close();
+        return true;
     }
-    
-    // Test function to verify merge functionality
-    void testMergeFunctionality(Repository* repo) {
-        if (repo->branchManager.branchMap.size() < 2) {
-            cout << "Need at least 2 branches to test merge functionality.\n";
-            return;
+
+    // Web API Methods
+    // One page of the undo and redo stacks as JSON: up to limit operations of
+    // each, counting from the top (the next to undo or redo) and skipping offset.
+    // Contents are left out unless asked for; each operation gives its size.
+    string getStacksJSON(size_t offset = 0, size_t limit = 50, bool withContent = false) {
+        string out;
+        JsonWriter json(JsonWriter::into(out));
+        json.raw("{\"offset\":").raw(to_string(offset))
+            .raw(",\"limit\":").raw(to_string(limit))
+            .raw(",\"maxOperations\":").raw(to_string(undoStack.operationLimit()))
+            .raw(",\"maxBytes\":").raw(to_string(undoStack.byteLimit()));
+        for (int s = 0; s < 2; s++) {
+            const OperationHistory& ops = s == 0 ? undoStack : redoStack;
+            const char* name = s == 0 ? "undo" : "redo";
+            json.raw(",\"").raw(name).raw("Count\":").raw(to_string(ops.size()))
+                .raw(",\"").raw(name).raw("Bytes\":").raw(to_string(ops.bytes()))
+                .raw(",\"").raw(name).raw("Dropped\":").raw(to_string(ops.dropped()))
+                .raw(",\"").raw(name).raw("Stack\":[");
+            for (size_t i = offset; i < ops.size() && i - offset < limit; i++) {
+                const Operation& op = ops.fromTop(i);
+                if (i > offset) json.raw(",");
+                json.raw("{\"type\":").str(op.type)
+                    .raw(",\"repoName\":").str(op.repoName)
+                    .raw(",\"fileName\":").str(op.fileName)
+                    .raw(",\"bytes\":").raw(to_string(op.text().size()));
+                if (withContent) json.raw(",\"content\":").str(op.text());
+                json.raw("}");
+            }
+            json.raw("]");
         }
-        
-        cout << "\n=== Testing Merge Functionality ===\n";
-        
-        // Get branch names
-        vector<string> branches = repo->branchManager.listBranches();
-        if (branches.size() < 2) return;
-        
-        string branch1 = branches[0];
-        string branch2 = branches[1];
-        
-        cout << "Testing merge from '" << branch1 << "' to '" << branch2 << "'\n";
-        
-        // Count files and commits before merge
-        Branch* b1 = repo->branchManager.branchMap[branch1];
-        Branch* b2 = repo->branchManager.branchMap[branch2];
-        
-        int files1Before = 0, files2Before = 0;
-        int commits1Before = 0, commits2Before = 0;
-        
-        File* temp = b1->fileHead;
-        while (temp) { files1Before++; temp = temp->next; }
-        
-        temp = b2->fileHead;
-        while (temp) { files2Before++; temp = temp->next; }
-        
-        Commit* commitTemp = b1->commits.head;
-        while (commitTemp) { commits1Before++; commitTemp = commitTemp->next; }
-        
-        commitTemp = b2->commits.head;
-        while (commitTemp) { commits2Before++; commitTemp = commitTemp->next; }
-        
-        cout << "Before merge:\n";
-        cout << "  " << branch1 << ": " << files1Before << " files, " << commits1Before << " commits\n";
-        cout << "  " << branch2 << ": " << files2Before << " files, " << commits2Before << " commits\n";
-        
-        // Perform merge
-        bool mergeSuccess = repo->branchManager.mergeBranch(branch1, branch2);
-        
-        if (mergeSuccess) {
-            // Count files and commits after merge
-            int files2After = 0, commits2After = 0;
-            
-            temp = b2->fileHead;
-            while (temp) { files2After++; temp = temp->next; }
-            
-            commitTemp = b2->commits.head;
-            while (commitTemp) { commits2After++; commitTemp = commitTemp->next; }
-            
-            cout << "After merge:\n";
-            cout << "  " << branch2 << ": " << files2After << " files, " << commits2After << " commits\n";
-            cout << "Merge test: " << (files2After >= files2Before && commits2After > commits2Before ? "PASSED" : "FAILED") << "\n";
+        json.raw("}");
+        json.flush();
+        return out;
+    }
+
+    // Both stacks share the limits; lowering them drops the oldest operations now
+    void setHistoryLimits(size_t operations, size_t bytes) {
+        undoStack.setLimits(operations, bytes);
+        redoStack.setLimits(operations, bytes);
+    }
+
+    // -------------------- Request Locking --------------------
+    // Versions are unique across GitHub instances, so a thread's cached catalog
+    // can only match the instance that built it
+    static uint64_t newCatalogVersion() {
+        static atomic<uint64_t> versions{0};
+        return ++versions;
+    }
+
+    // The current catalog. Each thread remembers the last one it used, so while
+    // the repository set is unchanged a lookup takes no lock. It holds only a
+    // weak reference: a thread that goes idle does not keep a replaced catalog,
+    // and the deleted repositories in it, alive.
+    CatalogRef catalog() {
+        static thread_local weak_ptr<const RepoCatalog> cached;
+        uint64_t version = catalogVersion.load(memory_order_acquire);
+        CatalogRef current = cached.lock();
+        if (current && current->version == version) return current;
+        current = atomic_load(&publishedCatalog);
+        if (!current || current->version != version) {
+            lock_guard<mutex> repos(catalogLock);
+            version = catalogVersion.load(memory_order_relaxed);
+            current = atomic_load(&publishedCatalog);
+            if (!current || current->version != version) {
+                shared_ptr<RepoCatalog> fresh = make_shared<RepoCatalog>();
+                fresh->version = version;
+                for (Repository* r = head; r; r = r->next) {
+                    fresh->order.push_back(r);
+                    fresh->byName[r->repoName] = repoMap[r->repoName];
+                    fresh->index.insert(r->repoName);
+                }
+                current = fresh;
+                atomic_store(&publishedCatalog, current);
+            }
+        }
+        cached = current;
+        return current;
+    }
+
+    // Shared lock on a repository for a reader. Whatever the read would build
+    // lazily (its contents from the snapshot, the content search index) is built
+    // first under the exclusive lock, so nothing is written under a shared lock.
+    shared_lock<shared_mutex> lockForReading(Repository* repo, bool contents, bool contentSearch = false) {
+        contents = contents || contentSearch;
+        for (;;) {
+            shared_lock<shared_mutex> reader(repo->lock);
+            FileTree* files = repo->image ? NULL : repo->getCurrentFiles();
+            if ((!contents || !repo->image) && (!contentSearch || !files || files->searchReady())) return reader;
+            reader.unlock();
+            unique_lock<shared_mutex> writer(repo->lock);
+            pageIn(repo);
+            files = repo->getCurrentFiles();
+            if (contentSearch && files) {
+                files->contentIndex();
+                files->warmIndex();
+            }
+        }
+    }
+
+    // Exclusive lock on a repository a request looked up. Not owned if the
+    // repository was deleted since; the request then answers "not found".
+    unique_lock<shared_mutex> lockForWriting(Repository* repo) {
+        unique_lock<shared_mutex> writer(repo->lock);
+        if (repo->deleted) writer.unlock();
+        else pageIn(repo);
+        return writer;
+    }
+
+    // Undo or redo for a web request. The top operation names the repository it
+    // changes, which must be locked before the operation is popped; if another
+    // request changed the stack in between, look again.
+    uint64_t stepHistory(bool isUndo) {
+        lock_guard<mutex> repos(catalogLock);      // Undoing a repository operation adds or removes one
+        OperationHistory& from = isUndo ? undoStack : redoStack;
+        for (;;) {
+            string target;
+            {
+                lock_guard<mutex> history(journalLock);
+                if (!from.empty()) target = from.top().repoName;
+            }
+            auto found = repoMap.find(target);
+            RepoRef repo = found == repoMap.end() ? nullptr : found->second;
+            unique_lock<shared_mutex> writer;
+            if (repo) writer = lockForWriting(repo.get());
+            lock_guard<mutex> history(journalLock);
+            if (!from.empty() && from.top().repoName != target) continue;
+            int64_t when = time(0);
+            if (isUndo) undo(when);
+            else redo(when);
+            return journal({isUndo ? "undo" : "redo", to_string(when)});
+        }
+    }
+
+    // -------------------- Web API Routes --------------------
+    // Each handler gets the path parameters (still percent-encoded) and the decoded
+    // body fields. Handlers may run on several threads at once; they take the
+    // locks described at the top of the class, journal while holding them and
+    // commit() after releasing them.
+    typedef ApiResponse (GitHub::*RouteHandler)(const RouteParams&, const FormFields& form);
+
+    // A route's handler and the metrics series its requests are recorded under
+    struct Route {
+        RouteHandler handler;
+        size_t series;
+    };
+
+    static const RouteTrie<Route>& routes() {
+        static const RouteTrie<Route> table = [] {
+            RouteTrie<Route> t;
+            auto add = [&t](const char* method, const char* pattern, RouteHandler handler) {
+                t.add(method, pattern, Route{handler, Metrics::instance().addSeries(Metrics::kRequest, string(method) + " " + pattern)});
+            };
+            add("GET", "/api/repositories", &GitHub::routeListRepositories);
+            add("POST", "/api/repositories", &GitHub::routeCreateRepository);
+            add("PUT", "/api/repositories/{repo}", &GitHub::routeEditRepository);
+            add("DELETE", "/api/repositories/{repo}", &GitHub::routeDeleteRepository);
+            add("POST", "/api/repositories/{repo}/files", &GitHub::routeCreateFile);
+            add("PUT", "/api/repositories/{repo}/files/{file:path}", &GitHub::routeEditFile);
+            add("DELETE", "/api/repositories/{repo}/files/{file:path}", &GitHub::routeDeleteFile);
+            add("GET", "/api/repositories/{repo}/branches", &GitHub::routeListBranches);
+            add("POST", "/api/repositories/{repo}/branches", &GitHub::routeCreateBranch);
+            add("PUT", "/api/repositories/{repo}/branches/switch", &GitHub::routeSwitchBranch);
+            add("POST", "/api/repositories/{repo}/branches/merge", &GitHub::routeMergeBranch);
+            add("POST", "/api/repositories/{repo}/tasks", &GitHub::routeEnqueueTask);
+            add("POST", "/api/repositories/{repo}/tasks/claim", &GitHub::routeClaimTasks);
+            add("GET", "/api/repositories/{repo}/tasks/stats", &GitHub::routeTaskStats);
+            add("POST", "/api/undo", &GitHub::routeUndo);
+            add("POST", "/api/redo", &GitHub::routeRedo);
+            add("GET", "/api/undo-redo-stacks", &GitHub::routeStacks);
+            add("PUT", "/api/undo-redo-stacks/limits", &GitHub::routeHistoryLimits);
+            add("GET", "/api/search/repos/{term}", &GitHub::routeSearchRepositories);
+            add("GET", "/api/search/files/{repo}/{term:path}", &GitHub::routeSearchFiles);
+            add("GET", "/api/metrics", &GitHub::routeMetrics);
+            return t;
+        }();
+        return table;
+    }
+
+    ApiResponse handleRequest(string_view method, string_view endpoint, string_view body = "") {
+        string buffer(body);
+        return handleRequest(method, endpoint, &buffer[0], buffer.size());
+    }
+
+    // The body is decoded in place, overwriting the caller's buffer. Every
+    // request is timed under its route's metrics series.
+    ApiResponse handleRequest(string_view method, string_view endpoint, char* body, size_t length) {
+        static const size_t unmatched = Metrics::instance().addSeries(Metrics::kRequest, "unmatched");
+        Route route{NULL, unmatched};
+        RouteParams params;
+        bool found = routes().match(method, endpoint, route, params);
+        Metrics::Timer timer(route.series);
+        ApiResponse response;
+        FormFields form;
+        if (!found) response = ApiResponse::error(404, "Endpoint not found");
+        else if (!form.parse(body, length)) response = ApiResponse::error(400, "Malformed request body");
+        else response = (this->*route.handler)(params, form);
+        timer.bytes = response.body.size();
+        timer.error = response.status >= 400;
+        return response;
+    }
+
+    static string resultsJSON(const char* prefix, const vector<string>& results) {
+        string out;
+        JsonWriter json(JsonWriter::into(out));
+        json.raw(prefix).raw("\"results\":[");
+        for (size_t i = 0; i < results.size(); i++) {
+            if (i > 0) json.raw(",");
+            json.str(results[i]);
+        }
+        json.raw("]}");
+        json.flush();
+        return out;
+    }
+
+    ApiResponse routeListRepositories(const RouteParams& params, const FormFields&) {
+        CatalogRef repos = catalog();
+        string out;
+        JsonWriter json(JsonWriter::into(out));
+        if (params.query.empty()) {
+            writeJSON(json, *repos, kAllFields);
+            json.flush();
+            return out;
+        }
+        // ?fields=name,description projects each repository; limit and/or cursor page through them by name
+        string query(params.query);
+        string fieldList = queryValue(query, "fields");
+        unsigned fields = fieldList.empty() ? (unsigned)kAllFields : parseFields(fieldList);
+        string limitValue = queryValue(query, "limit");
+        bool paged = !limitValue.empty() || query.find("cursor=") != string::npos;
+        if (paged) {
+            size_t limit = limitValue.empty() ? 50 : strtoul(limitValue.c_str(), NULL, 10);
+            limit = min<size_t>(max<size_t>(limit, 1), 1000);
+            writePage(json, *repos, percentDecode(queryValue(query, "cursor")), limit, fields);
         } else {
-            cout << "Merge failed!\n";
+            writeJSON(json, *repos, fields);
         }
-        
-        cout << "=== Merge Functionality Test Complete ===\n\n";
+        json.flush();
+        return out;
     }
 
-    // -------------------- Task Operations --------------------
-    void addTask(Repository* repo, string task) {
-        repo->tasks.push(task);
-        commits.addCommit("Added Task: " + task, currentUser);
-        undoStack.push({"removeTask", repo->repoName, "", task});
-        cout << "Task added.\n";
+    // Body: name=NAME&description=DESC&isPrivate=true
+    ApiResponse routeCreateRepository(const RouteParams&, const FormFields& form) {
+        string name(form.get("name"));
+        string description(form.get("description"));
+        bool isPrivate = form.get("isPrivate") == "true";
+        if (name.empty()) return ApiResponse::error(400, "Repository name is required");
+        uint64_t seq;
+        {
+            lock_guard<mutex> repos(catalogLock);
+            if (repoIndex.contains(name)) return ApiResponse::error(409, "Repository already exists");
+            lock_guard<mutex> history(journalLock);
+            int64_t when = time(0);
+            createRepository(name, description, isPrivate, when);
+            seq = journal({"createRepo", name, description, isPrivate ? "1" : "0", to_string(when)});
+        }
+        if (!commit(seq)) return ApiResponse::error(500, "Could not save the change");
+        return "{\"success\":true,\"message\":\"Repository created\"}";
     }
 
-    void removeTask(Repository* repo) {
-        if (repo->tasks.empty()) { cout << "No tasks.\n"; return; }
-        string t = repo->tasks.front();
-        repo->tasks.pop();
-        commits.addCommit("Removed Task: " + t, currentUser);
-        undoStack.push({"addTask", repo->repoName, "", t});
-        cout << "Task removed.\n";
+    // Body: description=DESC&isPrivate=true; either may be left out. Renaming is
+    // refused, since undo history and the log refer to repositories by name.
+    ApiResponse routeEditRepository(const RouteParams& params, const FormFields& form) {
+        string repoName = percentDecode(params[0]);
+        RepoRef repo = catalog()->find(repoName);
+        if (!repo) return ApiResponse::error(404, "Repository not found");
+        string_view newName = form.get("name");
+        if (!newName.empty() && newName != repoName) return ApiResponse::error(400, "Repositories cannot be renamed");
+        uint64_t seq;
+        {
+            unique_lock<shared_mutex> writer = lockForWriting(repo.get());
+            if (!writer) return ApiResponse::error(404, "Repository not found");
+            string description(form.get("description", repo->description));
+            bool isPrivate = form.has("isPrivate") ? form.get("isPrivate") == "true" : repo->isPrivate;
+            int64_t when = time(0);
+            editRepository(repo.get(), description, isPrivate, when);
+            seq = journal({"editRepo", repoName, description, isPrivate ? "1" : "0", to_string(when)});
+        }
+        if (!commit(seq)) return ApiResponse::error(500, "Could not save the change");
+        return "{\"success\":true,\"message\":\"Repository updated\"}";
     }
 
-    void viewTasks(Repository* repo) {
-        if (repo->tasks.empty()) { cout << "No tasks.\n"; return; }
-        queue<string> q = repo->tasks;
-        cout << "\nTasks in " << repo->repoName << ":\n";
-        while (!q.empty()) { cout << "- " << q.front() << endl; q.pop(); }
+    ApiResponse routeDeleteRepository(const RouteParams& params, const FormFields&) {
+        string repoName = percentDecode(params[0]);
+        uint64_t seq;
+        {
+            lock_guard<mutex> repos(catalogLock);
+            auto found = repoMap.find(repoName);
+            if (found == repoMap.end()) return ApiResponse::error(404, "Repository not found");
+            RepoRef repo = found->second;
+            unique_lock<shared_mutex> writer(repo->lock);
+            lock_guard<mutex> history(journalLock);
+            int64_t when = time(0);
+            deleteRepository(repoName, when);
+            seq = journal({"deleteRepo", repoName, to_string(when)});
+        }
+        if (!commit(seq)) return ApiResponse::error(500, "Could not save the change");
+        return "{\"success\":true,\"message\":\"Repository deleted\"}";
     }
 
-    // -------------------- Undo/Redo --------------------
-    void undo() {
-        if (undoStack.empty()) { 
-            cout << "Nothing to undo.\n"; 
-            return; 
+    // Body: name=FILE_NAME&content=CONTENT
+    ApiResponse routeCreateFile(const RouteParams& params, const FormFields& form) {
+        string repoName = percentDecode(params[0]);
+        RepoRef repo = catalog()->find(repoName);
+        if (!repo) return ApiResponse::error(404, "Repository not found");
+        if (!form.has("name") || !form.has("content")) return ApiResponse::error(400, "name and content are required");
+        string fileName(form.get("name"));
+        string_view content = form.get("content");
+        BlobRef blob = BlobStore::instance().intern(content);
+        uint64_t seq;
+        {
+            unique_lock<shared_mutex> writer = lockForWriting(repo.get());
+            if (!writer) return ApiResponse::error(404, "Repository not found");
+            if (findFile(repo.get(), fileName)) return ApiResponse::error(409, "File already exists");
+            lock_guard<mutex> history(journalLock);
+            int64_t when = time(0);
+            createFile(repo.get(), fileName, blob, when);
+            seq = journal({"createFile", repoName, fileName, content, to_string(when)});
         }
-        
-        // Get the operation to undo
-        Operation op = undoStack.top(); 
-        undoStack.pop();
-        
-        // Push to redo stack before performing the operation
-        redoStack.push(op);
-        
-        // Find the repository if needed
-        Repository* r = findRepo(op.repoName);
-        
-        // Perform the inverse operation without pushing to undo stack
-        if (op.type == "createFile" && r) {
-            // To undo create, we need to delete the file
-            File* temp = r->getCurrentFiles(), *prev = NULL;
-            while (temp && temp->name != op.fileName) { prev = temp; temp = temp->next; }
-            if (temp) {
-                if (prev) prev->next = temp->next; 
-                else r->setCurrentFiles(temp->next);
-                delete temp;
-                commits.addCommit("Undo: Deleted file " + op.fileName, currentUser);
+        if (!commit(seq)) return ApiResponse::error(500, "Could not save the change");
+        return "{\"success\":true,\"message\":\"File created\"}";
+    }
+
+    // Body: name=NEW_NAME&content=CONTENT. A different name renames the file.
+    ApiResponse routeEditFile(const RouteParams& params, const FormFields& form) {
+        string repoName = percentDecode(params[0]);
+        string fileName = percentDecode(params[1]);
+        RepoRef repo = catalog()->find(repoName);
+        if (!repo) return ApiResponse::error(404, "Repository not found");
+        if (!form.has("content")) return ApiResponse::error(400, "content is required");
+        string newName(form.get("name", fileName));
+        string_view content = form.get("content");
+        BlobRef blob = BlobStore::instance().intern(content);
+        uint64_t seq;
+        {
+            unique_lock<shared_mutex> writer = lockForWriting(repo.get());
+            if (!writer) return ApiResponse::error(404, "Repository not found");
+            if (!findFile(repo.get(), fileName)) return ApiResponse::error(404, "File not found");
+            lock_guard<mutex> history(journalLock);
+            int64_t when = time(0);
+            if (newName.empty() || newName == fileName) {
+                editFile(repo.get(), fileName, blob, when);
+                seq = journal({"editFile", repoName, fileName, content, to_string(when)});
+            } else {
+                if (findFile(repo.get(), newName)) return ApiResponse::error(409, "File already exists");
+                deleteFile(repo.get(), fileName, when);
+                journal({"deleteFile", repoName, fileName, to_string(when)});
+                createFile(repo.get(), newName, blob, when);
+                seq = journal({"createFile", repoName, newName, content, to_string(when)});
             }
         }
-        else if (op.type == "deleteFile" && r) {
-            // To undo delete, we need to create the file with its content
-            File* newFile = new File(op.fileName, op.content);
-            File* currentFiles = r->getCurrentFiles();
-            newFile->next = currentFiles;
-            r->setCurrentFiles(newFile);
-            commits.addCommit("Undo: Restored file " + op.fileName, currentUser);
+        if (!commit(seq)) return ApiResponse::error(500, "Could not save the change");
+        return "{\"success\":true,\"message\":\"File updated\"}";
+    }
+
+    ApiResponse routeDeleteFile(const RouteParams& params, const FormFields&) {
+        string repoName = percentDecode(params[0]);
+        string fileName = percentDecode(params[1]);
+        RepoRef repo = catalog()->find(repoName);
+        if (!repo) return ApiResponse::error(404, "Repository not found");
+        uint64_t seq;
+        {
+            unique_lock<shared_mutex> writer = lockForWriting(repo.get());
+            if (!writer) return ApiResponse::error(404, "Repository not found");
+            if (!findFile(repo.get(), fileName)) return ApiResponse::error(404, "File not found");
+            lock_guard<mutex> history(journalLock);
+            int64_t when = time(0);
+            deleteFile(repo.get(), fileName, when);
+            seq = journal({"deleteFile", repoName, fileName, to_string(when)});
         }
-        else if (op.type == "editFile" && r) {
-            // To undo edit, we need to restore the old content
-            File* temp = findFile(r, op.fileName);
-            if (temp) {
-                string currentContent = temp->content;
-                temp->content = op.content;
-                commits.addCommit("Undo: Reverted changes to " + op.fileName, currentUser);
-                // Update the redo stack with the current content for redo
-                redoStack.top().content = currentContent;
-            }
+        if (!commit(seq)) return ApiResponse::error(500, "Could not save the change");
+        return "{\"success\":true,\"message\":\"File deleted\"}";
+    }
+
+    ApiResponse routeUndo(const RouteParams&, const FormFields&) {
+        if (!commit(stepHistory(true))) return ApiResponse::error(500, "Could not save the change");
+        return "{\"success\":true,\"message\":\"Undo performed\"}";
+    }
+
+    ApiResponse routeRedo(const RouteParams&, const FormFields&) {
+        if (!commit(stepHistory(false))) return ApiResponse::error(500, "Could not save the change");
+        return "{\"success\":true,\"message\":\"Redo performed\"}";
+    }
+
+    // ?offset=0&limit=50&content=true pages through both stacks from the top
+    ApiResponse routeStacks(const RouteParams& params, const FormFields&) {
+        string query(params.query);
+        size_t offset = strtoul(queryValue(query, "offset", "0").c_str(), NULL, 10);
+        size_t limit = strtoul(queryValue(query, "limit", "50").c_str(), NULL, 10);
+        limit = min<size_t>(max<size_t>(limit, 1), 1000);
+        bool withContent = queryValue(query, "content") == "true";
+        lock_guard<mutex> history(journalLock);
+        return getStacksJSON(offset, limit, withContent);
+    }
+
+    // Body: operations=500&bytes=16777216; either may be left out
+    ApiResponse routeHistoryLimits(const RouteParams&, const FormFields& form) {
+        size_t operations, bytes;
+        uint64_t seq;
+        {
+            lock_guard<mutex> history(journalLock);
+            operations = form.has("operations") ? strtoul(string(form.get("operations")).c_str(), NULL, 10) : undoStack.operationLimit();
+            bytes = form.has("bytes") ? strtoul(string(form.get("bytes")).c_str(), NULL, 10) : undoStack.byteLimit();
+            setHistoryLimits(operations, bytes);
+            // Logged, so a replay trims the stacks at the same points
+            seq = journal({"historyLimits", to_string(operations), to_string(bytes)});
         }
-        else {
-            // For other operation types, use the original logic
-            if (op.type == "deleteRepo") deleteRepository(op.repoName);
-            else if (op.type == "createRepo") createRepository(op.repoName);
-            else if (op.type == "addTask" && r) addTask(r, op.content);
-            else if (op.type == "removeTask" && r) removeTask(r);
+        if (!commit(seq)) return ApiResponse::error(500, "Could not save the change");
+        return "{\"success\":true,\"maxOperations\":" + to_string(operations) + ",\"maxBytes\":" + to_string(bytes) + "}";
+    }
+
+    ApiResponse routeListBranches(const RouteParams& params, const FormFields&) {
+        RepoRef repo = catalog()->find(percentDecode(params[0]));
+        if (!repo) return ApiResponse::error(404, "Repository not found");
+        shared_lock<shared_mutex> reader = lockForReading(repo.get(), true);
+        return repo->branchManager.getBranchesJSON();
+    }
+
+    // Branch operations do not touch the undo stack, so they hold only their
+    // repository's lock; a long merge does not hold up other repositories.
+    // Body: baseBranch=main&newBranch=feature
+    ApiResponse routeCreateBranch(const RouteParams& params, const FormFields& form) {
+        string repoName = percentDecode(params[0]);
+        RepoRef repo = catalog()->find(repoName);
+        if (!repo) return ApiResponse::error(404, "Repository not found");
+        if (!form.has("baseBranch") || !form.has("newBranch")) return ApiResponse::error(400, "baseBranch and newBranch are required");
+        string baseBranch(form.get("baseBranch"));
+        string newBranch(form.get("newBranch"));
+        uint64_t seq;
+        {
+            unique_lock<shared_mutex> writer = lockForWriting(repo.get());
+            if (!writer) return ApiResponse::error(404, "Repository not found");
+            if (!repo->branchManager.findBranch(baseBranch)) return ApiResponse::error(404, "Branch not found");
+            if (repo->branchManager.findBranch(newBranch)) return ApiResponse::error(409, "Branch already exists");
+            int64_t when = time(0);
+            createBranch(repo.get(), baseBranch, newBranch, when);
+            seq = journal({"createBranch", repoName, baseBranch, newBranch, to_string(when)});
         }
-        
-        cout << "Undo performed: " << op.type << " on " << op.fileName << "\n";
+        if (!commit(seq)) return ApiResponse::error(500, "Could not save the change");
+        return "{\"success\":true,\"message\":\"Branch created\"}";
     }
 
-    void redo() {
-        if (redoStack.empty()) { 
-            cout << "Nothing to redo.\n"; 
-            return; 
+    // Body: branchName=main
+    ApiResponse routeSwitchBranch(const RouteParams& params, const FormFields& form) {
+        string repoName = percentDecode(params[0]);
+        RepoRef repo = catalog()->find(repoName);
+        if (!repo) return ApiResponse::error(404, "Repository not found");
+        if (!form.has("branchName")) return ApiResponse::error(400, "branchName is required");
+        string branchName(form.get("branchName"));
+        uint64_t seq;
+        {
+            unique_lock<shared_mutex> writer = lockForWriting(repo.get());
+            if (!writer) return ApiResponse::error(404, "Repository not found");
+            if (!repo->branchManager.findBranch(branchName)) return ApiResponse::error(404, "Branch not found");
+            int64_t when = time(0);
+            switchBranch(repo.get(), branchName, when);
+            seq = journal({"switchBranch", repoName, branchName, to_string(when)});
         }
-        
-        // Get the operation to redo
-        Operation op = redoStack.top();
-        redoStack.pop();
-        
-        // Push to undo stack before performing the operation
-        undoStack.push(op);
-        
-        // Find the repository if needed
-        Repository* r = findRepo(op.repoName);
-        
-        // Perform the operation without pushing to redo stack
-        if (op.type == "createFile" && r) {
-            File* newFile = new File(op.fileName, op.content);
-            File* currentFiles = r->getCurrentFiles();
-            newFile->next = currentFiles;
-            r->setCurrentFiles(newFile);
-            commits.addCommit("Redo: Created file " + op.fileName, currentUser);
-        }
-        else if (op.type == "deleteFile" && r) {
-            File* temp = r->getCurrentFiles(), *prev = NULL;
-            while (temp && temp->name != op.fileName) { prev = temp; temp = temp->next; }
-            if (temp) {
-                if (prev) prev->next = temp->next; 
-                else r->setCurrentFiles(temp->next);
-                delete temp;
-                commits.addCommit("Redo: Deleted file " + op.fileName, currentUser);
+        if (!commit(seq)) return ApiResponse::error(500, "Could not save the change");
+        return "{\"success\":true,\"message\":\"Branch switched\"}";
+    }
+
+    // Body: sourceBranch=feature&targetBranch=main
+    ApiResponse routeMergeBranch(const RouteParams& params, const FormFields& form) {
+        string repoName = percentDecode(params[0]);
+        RepoRef repo = catalog()->find(repoName);
+        if (!repo) return ApiResponse::error(404, "Repository not found");
+        if (!form.has("sourceBranch") || !form.has("targetBranch")) return ApiResponse::error(400, "sourceBranch and targetBranch are required");
+        string sourceBranch(form.get("sourceBranch"));
+        string targetBranch(form.get("targetBranch"));
+        uint64_t seq;
+        MergeResult merge;
+        {
+            unique_lock<shared_mutex> writer = lockForWriting(repo.get());
+            if (!writer) return ApiResponse::error(404, "Repository not found");
+            if (!repo->branchManager.findBranch(sourceBranch) || !repo->branchManager.findBranch(targetBranch)) {
+                return ApiResponse::error(404, "Branch not found");
             }
+            int64_t when = time(0);
+            merge = mergeBranch(repo.get(), sourceBranch, targetBranch, when);
+            seq = journal({"mergeBranch", repoName, sourceBranch, targetBranch, to_string(when)});
         }
-        else if (op.type == "editFile" && r) {
-            File* temp = findFile(r, op.fileName);
-            if (temp) {
-                string oldContent = temp->content;
-                temp->content = op.content;
-                commits.addCommit("Redo: Edited file " + op.fileName, currentUser);
-                // Update the undo stack with the old content for undo
-                undoStack.top().content = oldContent;
-            }
+        if (!commit(seq)) return ApiResponse::error(500, "Could not save the change");
+        string out;
+        JsonWriter json(JsonWriter::into(out));
+        json.raw("{\"success\":true,\"message\":\"Branch merged\",\"filesAdded\":").raw(to_string(merge.filesAdded))
+            .raw(",\"filesUpdated\":").raw(to_string(merge.filesUpdated))
+            .raw(",\"filesDeleted\":").raw(to_string(merge.filesDeleted))
+            .raw(",\"commitsMerged\":").raw(to_string(merge.commitsMerged))
+            .raw(",\"conflicts\":[");
+        for (size_t i = 0; i < merge.conflicts.size(); i++) {
+            if (i > 0) json.raw(",");
+            json.str(merge.conflicts[i]);
         }
-        else {
-            // For other operation types, use the original logic
-            if (op.type == "deleteRepo") deleteRepository(op.repoName);
-            else if (op.type == "createRepo") createRepository(op.repoName);
-            else if (op.type == "addTask" && r) addTask(r, op.content);
-            else if (op.type == "removeTask" && r) removeTask(r);
+        json.raw("]}");
+        json.flush();
+        return out;
+    }
+
+    // Task queues are fed and drained by automation clients. The queue takes no
+    // lock, so pushes and claims on one repository only hold its shared lock; the
+    // repository's taskOrder mutex just keeps each one next to its log record.
+    // Queued tasks are work items, not history: they make no commits or undo entries.
+    // Body: task=lint
+    ApiResponse routeEnqueueTask(const RouteParams& params, const FormFields& form) {
+        RepoRef repo = catalog()->find(percentDecode(params[0]));
+        if (!repo) return ApiResponse::error(404, "Repository not found");
+        if (!form.has("task")) return ApiResponse::error(400, "task is required");
+        string task(form.get("task"));
+        TaskQueue& tasks = repo->tasks;
+        uint64_t seq;
+        string depth;
+        {
+            shared_lock<shared_mutex> reader = lockForReading(repo.get(), true);
+            if (repo->deleted) return ApiResponse::error(404, "Repository not found");
+            lock_guard<mutex> order(repo->taskOrder);
+            bool queued = tasks.push(task);
+            depth = "\"queued\":" + to_string(tasks.size()) + ",\"capacity\":" + to_string(tasks.capacity()) + "}";
+            // 503 so clients back off
+            if (!queued) return ApiResponse(503, "{\"error\":\"Task queue full\"," + depth);
+            seq = journal({"enqueueTask", repo->repoName, task});
         }
-        
-        cout << "Redo performed: " << op.type << " on " << op.fileName << "\n";
+        if (!commit(seq)) return ApiResponse::error(500, "Could not save the change");
+        return "{\"success\":true," + depth;
     }
 
-    void showHistory() { commits.showCommits(); }
+    // Body: max=10 (default 1). Answers the claimed tasks in queue order.
+    ApiResponse routeClaimTasks(const RouteParams& params, const FormFields& form) {
+        RepoRef repo = catalog()->find(percentDecode(params[0]));
+        if (!repo) return ApiResponse::error(404, "Repository not found");
+        size_t maxCount = form.has("max") ? strtoul(string(form.get("max")).c_str(), NULL, 10) : 1;
+        vector<string> claimed;
+        uint64_t seq;
+        {
+            shared_lock<shared_mutex> reader = lockForReading(repo.get(), true);
+            if (repo->deleted) return ApiResponse::error(404, "Repository not found");
+            lock_guard<mutex> order(repo->taskOrder);
+            repo->tasks.popBatch(claimed, maxCount);
+            seq = claimed.empty() ? 0 : journal({"claimTasks", repo->repoName, to_string(claimed.size())});
+        }
+        if (!claimed.empty() && !commit(seq)) return ApiResponse::error(500, "Could not save the change");
+        string out;
+        JsonWriter json(JsonWriter::into(out));
+        json.raw("{\"tasks\":[");
+        for (size_t i = 0; i < claimed.size(); i++) {
+            if (i > 0) json.raw(",");
+            json.str(claimed[i]);
+        }
+        json.raw("],\"remaining\":").raw(to_string(repo->tasks.size())).raw("}");
+        json.flush();
+        return out;
+    }
 
-    // -------------------- Search Methods --------------------
-    vector<string> searchRepositories(const string& term) {
+    // Depth, totals, rates per second since startup and time spent queued
+    ApiResponse routeTaskStats(const RouteParams& params, const FormFields&) {
+        RepoRef repo = catalog()->find(percentDecode(params[0]));
+        if (!repo) return ApiResponse::error(404, "Repository not found");
+        shared_lock<shared_mutex> reader = lockForReading(repo.get(), true);
+        TaskQueue::Stats s = repo->tasks.stats();
+        char out[512];
+        snprintf(out, sizeof(out),
+                 "{\"queued\":%zu,\"capacity\":%zu,\"enqueued\":%llu,\"dequeued\":%llu,\"rejected\":%llu,"
+                 "\"enqueuedPerSecond\":%.2f,\"dequeuedPerSecond\":%.2f,\"averageWaitMs\":%.3f,\"maxWaitMs\":%.3f}",
+                 s.depth, s.capacity, (unsigned long long)s.enqueued, (unsigned long long)s.dequeued,
+                 (unsigned long long)s.rejected, s.enqueueRate, s.dequeueRate, s.averageWaitMs, s.maxWaitMs);
+        return out;
+    }
+
+    // /api/search/repos/TERM, or /api/search/repos/PREFIX?prefix=true for autocomplete
+    ApiResponse routeSearchRepositories(const RouteParams& params, const FormFields&) {
+        string term = percentDecode(params[0]);
+        bool prefixOnly = queryValue(string(params.query), "prefix") == "true";
+        CatalogRef repos = catalog();
         vector<string> results;
-        repoBST.searchContaining(repoBST.root, term, results);
-        return results;
+        if (prefixOnly) repos->index.scanPrefix(term, results);
+        else repos->index.searchContaining(term, results);
+        return resultsJSON("{", results);
     }
-    
-    vector<string> searchInRepository(Repository* repo, const string& term, bool searchContent = false) {
+
+    // /api/search/files/REPO_NAME/SEARCH_TERM?content=true
+    ApiResponse routeSearchFiles(const RouteParams& params, const FormFields&) {
+        string repoName = percentDecode(params[0]);
+        RepoRef repo = catalog()->find(repoName);
+        if (!repo) return ApiResponse::error(404, "Repository not found");
+        bool searchContent = queryValue(string(params.query), "content") == "true";
+        string term = percentDecode(params[1]);
         vector<string> results;
-        if (!repo) return results;
-        
-        File* current = repo->getCurrentFiles();
-        while (current) {
-            if (searchContent) {
-                // Search in file content
-                string contentLower = current->content;
-                transform(contentLower.begin(), contentLower.end(), contentLower.begin(), ::tolower);
-                string termLower = term;
-                transform(termLower.begin(), termLower.end(), termLower.begin(), ::tolower);
-                
-                if (contentLower.find(termLower) != string::npos) {
-                    results.push_back(current->name);
-                }
-            } else {
-                // Search in filename
-                string nameLower = current->name;
-                transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
-                string termLower = term;
-                transform(termLower.begin(), termLower.end(), termLower.begin(), ::tolower);
-                
-                if (nameLower.find(termLower) != string::npos) {
-                    results.push_back(current->name);
-                }
-            }
-            current = current->next;
+        {
+            shared_lock<shared_mutex> reader = lockForReading(repo.get(), true, searchContent && term.size() >= 3);
+            results = searchInRepository(repo.get(), term, searchContent);
         }
-        return results;
+        string prefix;
+        JsonWriter json(JsonWriter::into(prefix));
+        json.raw("{\"repository\":").str(repoName).raw(",");
+        json.flush();
+        return resultsJSON(prefix.c_str(), results);
     }
-    
-    // -------------------- Web Interface Methods --------------------
-    string toJSON() {
-        stringstream json;
-        json << "{\"repositories\":[";
-        Repository* temp = head;
-        bool first = true;
-        while (temp) {
-            if (!first) json << ",";
-            json << "{\"name\":\"" << temp->repoName 
-                 << "\",\"description\":\"" << (temp->description.empty() ? "Repository" : temp->description) << "\",\"createdDate\":\"" << getCurrentDate() 
-                 << "\",\"isPrivate\":" << (temp->isPrivate ? "true" : "false") << ",\"currentBranch\":\"" << temp->branchManager.currentBranch 
-                 << "\",\"branches\":" << temp->branchManager.getBranchesJSON().substr(1, temp->branchManager.getBranchesJSON().length()-2) // Remove outer braces
-                 << ",\"files\":[";
-            
-            File* fileTemp = temp->getCurrentFiles();
-            bool firstFile = true;
-            while (fileTemp) {
-                if (!firstFile) json << ",";
-                json << "{\"name\":\"" << fileTemp->name 
-                     << "\",\"info\":\"" << (fileTemp->content.length() > 50 ? fileTemp->content.substr(0, 50) + "..." : fileTemp->content)
-                     << "\",\"date\":\"a few seconds ago\",\"content\":\"";
-                
-                // Escape quotes and newlines in content
-                string escapedContent = fileTemp->content;
-                size_t pos = 0;
-                while ((pos = escapedContent.find("\"", pos)) != string::npos) {
-                    escapedContent.replace(pos, 1, "\\\"");
-                    pos += 2;
-                }
-                pos = 0;
-                while ((pos = escapedContent.find("\n", pos)) != string::npos) {
-                    escapedContent.replace(pos, 1, "\\n");
-                    pos += 2;
-                }
-                
-                json << escapedContent << "\"}";
-                fileTemp = fileTemp->next;
-                firstFile = false;
-            }
-            json << "],\"commits\":[";
-            
-            // Get commits from current branch
-            Branch* currentBranch = temp->branchManager.getCurrentBranch();
-            if (currentBranch && currentBranch->commits.head) {
-                Commit* commitTemp = currentBranch->commits.head;
-                bool firstCommit = true;
-                while (commitTemp) {
-                    if (!firstCommit) json << ",";
-                    json << "{\"message\":\"" << commitTemp->action 
-                         << "\",\"author\":\"" << commitTemp->user 
-                         << "\",\"date\":\"" << commitTemp->date << "\"}";
-                    commitTemp = commitTemp->next;
-                    firstCommit = false;
-                }
-            } else {
-                // Fallback commit if no branch commits exist
-                json << "{\"message\":\"Repository created\",\"author\":\"" << currentUser << "\",\"date\":\"" << getCurrentDate() << "\"}";
-            }
-            
-            json << "]}";
-            temp = temp->next;
-            first = false;
+
+    // Prometheus text format: the recorded series, then gauges read at scrape
+    // time. Pool and queue figures are relaxed atomics, so no repository is locked.
+    ApiResponse routeMetrics(const RouteParams&, const FormFields&) {
+        string out;
+        Metrics::instance().writePrometheus(out);
+        CatalogRef repos = catalog();
+        size_t blocks = 0, reserved = 0, queued = 0;
+        for (Repository* r : repos->order) {
+            blocks += r->nodes.blocksInUse();
+            reserved += r->nodes.bytesReserved();
+            queued += r->tasks.size();
         }
-        json << "]}";
-        return json.str();
+        auto gauge = [&out](const char* name, const char* help, unsigned long long value) {
+            char line[256];
+            snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s gauge\n%s %llu\n", name, help, name, name, value);
+            out += line;
+        };
+        gauge("github_repositories", "Repositories.", repos->order.size());
+        gauge("github_node_pool_blocks_in_use", "File tree nodes allocated from repository node pools.", blocks);
+        gauge("github_node_pool_bytes_reserved", "Bytes of slabs held by repository node pools.", reserved);
+        gauge("github_blobs", "Distinct file contents in the blob store.", BlobStore::instance().size());
+        gauge("github_symbols", "Interned names in the symbol table.", SymbolTable::instance().size());
+        gauge("github_commits", "Entries in the global commit history.", commits.size());
+        gauge("github_queued_tasks", "Tasks waiting in repository task queues.", queued);
+        gauge("github_wal_bytes", "Size of the write-ahead log.", storeOpen ? opLog.size() : 0);
+        return out;
     }
+};
 
-    string getCurrentDate() {
-        time_t now = time(0);
-        string date = ctime(&now);
-        date.pop_back(); // remove newline
-        return date;
-    }
+// -------------------- HTTP Server --------------------
+// Loopback HTTP/1.1 server. Every worker thread runs its own event loop over the
+// shared non-blocking listening socket plus the connections it accepted, so a
+// connection never moves between threads. Requests pipelined on a connection are
+// answered in order and their responses go out in one write; connections stay
+// open unless the client asks to close (HTTP/1.0 defaults to closing).
+#ifdef _WIN32
+typedef SOCKET socket_t;
+static const socket_t kInvalidSocket = INVALID_SOCKET;
+static void closeSocket(socket_t s) { closesocket(s); }
+static bool socketWouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static void setNonBlocking(socket_t s) { u_long on = 1; ioctlsocket(s, FIONBIO, &on); }
+static const int kSendFlags = 0;
+#else
+typedef int socket_t;
+static const socket_t kInvalidSocket = -1;
+static void closeSocket(socket_t s) { ::close(s); }
+static bool socketWouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+static void setNonBlocking(socket_t s) { fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK); }
+#ifdef MSG_NOSIGNAL
+static const int kSendFlags = MSG_NOSIGNAL;     // A closed peer must not raise SIGPIPE
+#else
+static const int kSendFlags = 0;
+#endif
+#endif
 
-    void saveToFile() {
-        ofstream file("data.json");
-        file << toJSON();
-        file.close();
+// Views into the connection's input buffer; valid until the handler returns
+struct HttpRequest {
+    string_view method;
+    string_view target;     // Path and query string, e.g. /api/repositories?limit=20
+    char* body = NULL;      // Writable, so the handler can decode it in place
+    size_t bodyLength = 0;
+    bool keepAlive = true;
+};
+
+struct HttpResponse {
+    int status = 200;
+    string contentType = "application/json";
+    string body;
+};
+
+// Readiness notification: epoll on Linux, select() everywhere else
+class Poller {
+public:
+    struct Event {
+        socket_t fd;
+        bool readable, writable;
+    };
+
+#ifdef __linux__
+    Poller() : epfd(epoll_create1(0)) {}
+    ~Poller() { ::close(epfd); }
+
+    // exclusive wakes only one of the workers sharing fd (the listening socket)
+    void add(socket_t fd, bool exclusive = false) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+#ifdef EPOLLEXCLUSIVE
+        if (exclusive) ev.events |= EPOLLEXCLUSIVE;
+#endif
+        ev.data.fd = fd;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    }
+    void watch(socket_t fd, bool read, bool write) {
+        epoll_event ev{};
+        ev.events = (read ? (uint32_t)EPOLLIN : 0u) | (write ? (uint32_t)EPOLLOUT : 0u);
+        ev.data.fd = fd;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
     }
+    void remove(socket_t fd) { epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL); }
 
-    void loadFromFile() {
-        // Simple initialization with sample data if file doesn't exist
-        ifstream file("data.json");
-        if (!file.good()) {
-            // Create sample repository with files
-            createRepository("LeetCode");
-            Repository* repo = findRepo("LeetCode");
-            if (repo) {
-                createFile(repo, "LeetCodeSolutions.js", "// JavaScript solutions for LeetCode problems\n\n// Two Sum Problem\nfunction twoSum(nums, target) {\n    const map = new Map();\n    for (let i = 0; i < nums.length; i++) {\n        const complement = target - nums[i];\n        if (map.has(complement)) {\n            return [map.get(complement), i];\n        }\n        map.set(nums[i], i);\n    }\n    return [];\n}");
-                createFile(repo, "README.md", "# LeetCode Solutions\n\nThis repository contains my solutions to various LeetCode problems.\n\n## Structure\n- Each solution includes time and space complexity analysis\n- Solutions are organized by difficulty level\n- Test cases are provided for each problem");
-            }
-            saveToFile();
+    void wait(vector<Event>& events, int timeoutMillis) {
+        epoll_event ready[256];
+        int n = epoll_wait(epfd, ready, 256, timeoutMillis);
+        events.clear();
+        for (int i = 0; i < n; i++) {
+            uint32_t e = ready[i].events;
+            events.push_back({ready[i].data.fd, (e & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0, (e & EPOLLOUT) != 0});
         }
-        file.close();
     }
 
-    // Web API Methods
-    // Get undo and redo stacks as JSON
-    string getStacksJSON() {
-        stringstream json;
-        json << "{\"undoStack\":[";
-        
-        // Create a temporary stack to reverse the order (since stack is LIFO)
-        stack<Operation> tempStack = undoStack;
-        vector<Operation> reversedUndo;
-        while (!tempStack.empty()) {
-            reversedUndo.push_back(tempStack.top());
-            tempStack.pop();
+private:
+    int epfd;
+#else
+    void add(socket_t fd, bool = false) { watched[fd] = Interest{true, false}; }
+    void watch(socket_t fd, bool read, bool write) { watched[fd] = Interest{read, write}; }
+    void remove(socket_t fd) { watched.erase(fd); }
+
+    void wait(vector<Event>& events, int timeoutMillis) {
+        fd_set readSet, writeSet;
+        FD_ZERO(&readSet);
+        FD_ZERO(&writeSet);
+        socket_t maxFd = 0;
+        for (auto& w : watched) {
+            if (w.second.read) FD_SET(w.first, &readSet);
+            if (w.second.write) FD_SET(w.first, &writeSet);
+            maxFd = max(maxFd, w.first);
         }
-        
-        // Add undo stack items in chronological order (oldest first)
-        for (size_t i = reversedUndo.size(); i > 0; i--) {
-            const Operation& op = reversedUndo[i-1];
-            if (i < reversedUndo.size()) json << ",";
-            json << "{\"type\":\"" << op.type 
-                 << "\",\"repoName\":\"" << op.repoName 
-                 << "\",\"fileName\":\"" << op.fileName 
-                 << "\",\"content\":\"" << op.content << "\"}";
+        timeval timeout;
+        timeout.tv_sec = timeoutMillis / 1000;
+        timeout.tv_usec = (timeoutMillis % 1000) * 1000;
+        events.clear();
+        if (select((int)maxFd + 1, &readSet, &writeSet, NULL, &timeout) <= 0) return;
+        for (auto& w : watched) {
+            bool r = FD_ISSET(w.first, &readSet) != 0, wr = FD_ISSET(w.first, &writeSet) != 0;
+            if (r || wr) events.push_back({w.first, r, wr});
         }
-        
-        json << "],\"redoStack\":[";
-        
-        // Add redo stack items
-        tempStack = redoStack;
-        int count = 0;
-        while (!tempStack.empty()) {
-            Operation op = tempStack.top();
-            tempStack.pop();
-            if (count++ > 0) json << ",";
-            json << "{\"type\":\"" << op.type 
-                 << "\",\"repoName\":\"" << op.repoName 
-                 << "\",\"fileName\":\"" << op.fileName 
-                 << "\",\"content\":\"" << op.content << "\"}";
+    }
+
+    // Sockets select() can watch; the rest are refused
+    static bool fits(socket_t fd) {
+#ifdef _WIN32
+        (void)fd;
+        return true;    // Winsock's FD_SETSIZE limits the count, not the value
+#else
+        return fd < FD_SETSIZE;
+#endif
+    }
+
+private:
+    struct Interest { bool read, write; };
+    map<socket_t, Interest> watched;
+#endif
+};
+
+class HttpServer {
+public:
+    typedef function<HttpResponse(const HttpRequest&)> Handler;
+
+    static const size_t kMaxHeaderBytes = 64 << 10;
+    static const size_t kMaxBodyBytes = 64 << 20;
+    static const size_t kMaxPendingOutput = 1 << 20;   // Stop reading requests until this much is sent
+
+    explicit HttpServer(Handler h) : handler(h) {}
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+    ~HttpServer() { stop(); }
+
+    // Listen on 127.0.0.1:port (0 picks a free port) with the given number of workers
+    bool start(int port, int workerCount = 0) {
+#ifdef _WIN32
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+#endif
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (listener == kInvalidSocket) return false;
+        int on = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons((uint16_t)port);
+        if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0) {
+            closeSocket(listener);
+            listener = kInvalidSocket;
+            return false;
         }
-        
-        json << "]}";
-        return json.str();
+        socklen_t length = sizeof(address);
+        getsockname(listener, (sockaddr*)&address, &length);
+        boundPort = ntohs(address.sin_port);
+        setNonBlocking(listener);
+
+        if (workerCount <= 0) workerCount = max(2, (int)thread::hardware_concurrency());
+        running = true;
+        for (int i = 0; i < workerCount; i++) workers.emplace_back([this] { workerLoop(); });
+        return true;
+    }
+
+    void stop() {
+        if (!running) return;
+        running = false;
+        for (thread& worker : workers) worker.join();
+        workers.clear();
+        closeSocket(listener);
+        listener = kInvalidSocket;
+#ifdef _WIN32
+        WSACleanup();
+#endif
     }
 
-    string handleRequest(string method, string endpoint, string data = "") {
-        if (method == "GET" && endpoint == "/api/repositories") {
-            return toJSON();
+    int port() const { return boundPort; }
+
+    // Parse one request from the front of data. Returns its length, or 0 if more
+    // bytes are needed; error is set to an HTTP status if it cannot be served.
+    static size_t parseRequest(char* buffer, size_t size, HttpRequest& request, int& error) {
+        string_view data(buffer, size);
+        size_t headerEnd = data.find("\r\n\r\n");
+        if (headerEnd == string_view::npos) {
+            if (data.size() > kMaxHeaderBytes) error = 431;
+            return 0;
         }
-        else if (method == "GET" && endpoint == "/api/undo-redo-stacks") {
-            return getStacksJSON();
+        size_t lineEnd = data.find("\r\n");
+        string_view line = data.substr(0, lineEnd);
+        size_t sp1 = line.find(' '), sp2 = line.rfind(' ');
+        if (sp1 == string_view::npos || sp2 == sp1 || line.compare(sp2 + 1, 5, "HTTP/") != 0) {
+            error = 400;
+            return 0;
         }
-        else if (method == "POST" && endpoint == "/api/repositories") {
-            // Parse repository data
-            string name = "", description = "";
-            bool isPrivate = false;
-            
-            size_t namePos = data.find("name=");
-            if (namePos != string::npos) {
-                size_t nameEnd = data.find("&", namePos);
-                name = data.substr(namePos + 5, nameEnd == string::npos ? string::npos : nameEnd - namePos - 5);
-            }
-            
-            size_t descPos = data.find("description=");
-            if (descPos != string::npos) {
-                size_t descEnd = data.find("&", descPos);
-                description = data.substr(descPos + 12, descEnd == string::npos ? string::npos : descEnd - descPos - 12);
+        request.method = line.substr(0, sp1);
+        request.target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        bool http10 = line.substr(sp2 + 1) == "HTTP/1.0";
+        request.keepAlive = !http10;
+
+        size_t contentLength = 0;
+        bool haveLength = false;
+        size_t pos = lineEnd + 2;
+        while (pos < headerEnd) {
+            size_t end = data.find("\r\n", pos);
+            string_view header = data.substr(pos, end - pos);
+            pos = end + 2;
+            size_t colon = header.find(':');
+            if (colon == string_view::npos) continue;
+            string_view name = header.substr(0, colon);
+            string_view value = header.substr(colon + 1);
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+            if (equalsIgnoreCase(name, "content-length")) {
+                // Repeated headers or a list ("5, 5") must all agree, or the body's
+                // end is ambiguous (RFC 7230 section 3.3.2)
+                while (true) {
+                    size_t comma = value.find(',');
+                    string_view item = value.substr(0, comma);
+                    while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) item.remove_suffix(1);
+                    if (item.empty() || item.size() > 10) { error = item.empty() ? 400 : 413; return 0; }
+                    size_t length = 0;
+                    for (char c : item) {
+                        if (c < '0' || c > '9') { error = 400; return 0; }
+                        length = length * 10 + (c - '0');
+                    }
+                    if (haveLength && length != contentLength) { error = 400; return 0; }
+                    if (length > kMaxBodyBytes) { error = 413; return 0; }
+                    contentLength = length;
+                    haveLength = true;
+                    if (comma == string_view::npos) break;
+                    value.remove_prefix(comma + 1);
+                    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+                }
             }
-            
-            size_t privPos = data.find("isPrivate=");
-            if (privPos != string::npos) {
-                string privValue = data.substr(privPos + 10, 4); // "true" or "fals"
-                isPrivate = (privValue == "true");
+            else if (equalsIgnoreCase(name, "transfer-encoding")) {
+                error = 501;    // Chunked bodies are not supported
+                return 0;
             }
-            
-            if (!name.empty()) {
-                createRepository(name, description, isPrivate);
-                saveToFile();
-                return "{\"success\":true,\"message\":\"Repository created\"}";
-            }
-        }
-        else if (method == "DELETE" && endpoint.find("/api/repositories/") == 0) {
-            string repoName = endpoint.substr(17); // Remove "/api/repositories/"
-            deleteRepository(repoName);
-            saveToFile();
-            return "{\"success\":true,\"message\":\"Repository deleted\"}";
-        }
-        else if (method == "POST" && endpoint.find("/api/repositories/") == 0 && endpoint.find("/files") != string::npos) {
-            // Extract repo name
-            size_t start = 17; // "/api/repositories/"
-            size_t end = endpoint.find("/files");
-            string repoName = endpoint.substr(start, end - start);
-            Repository* repo = findRepo(repoName);
-            
-            if (repo) {
-                // Parse file data (simplified)
-                size_t namePos = data.find("name=");
-                size_t contentPos = data.find("content=");
-                if (namePos != string::npos && contentPos != string::npos) {
-                    string fileName = data.substr(namePos + 5, data.find("&", namePos) - namePos - 5);
-                    string content = data.substr(contentPos + 8);
-                    createFile(repo, fileName, content);
-                    saveToFile();
-                    return "{\"success\":true,\"message\":\"File created\"}";
-                }
+            else if (equalsIgnoreCase(name, "connection")) {
+                if (equalsIgnoreCase(value, "close")) request.keepAlive = false;
+                else if (equalsIgnoreCase(value, "keep-alive")) request.keepAlive = true;
             }
         }
-        else if (method == "POST" && endpoint == "/api/undo") {
-            undo();
-            saveToFile();
-            return "{\"success\":true,\"message\":\"Undo performed\"}";
+        size_t bodyStart = headerEnd + 4;
+        if (data.size() - bodyStart < contentLength) return 0;
+        request.body = buffer + bodyStart;
+        request.bodyLength = contentLength;
+        return bodyStart + contentLength;
+    }
+
+    static void appendResponse(string& out, const HttpResponse& response, bool keepAlive) {
+        out += "HTTP/1.1 ";
+        out += to_string(response.status);
+        out += ' ';
+        out += statusText(response.status);
+        out += "\r\nContent-Type: ";
+        out += response.contentType;
+        out += "\r\nContent-Length: ";
+        out += to_string(response.body.size());
+        out += "\r\nAccess-Control-Allow-Origin: *\r\n";
+        if (response.status == 204) out += "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\nAccess-Control-Allow-Headers: Content-Type\r\n";
+        if (!keepAlive) out += "Connection: close\r\n";
+        out += "\r\n";
+        out += response.body;
+    }
+
+private:
+    struct Connection {
+        socket_t fd;
+        string in;
+        string out;
+        size_t sent = 0;
+        bool closeAfterWrite = false;
+        bool watchingWrite = false;
+    };
+
+    Handler handler;
+    socket_t listener = kInvalidSocket;
+    int boundPort = 0;
+    atomic<bool> running{false};
+    vector<thread> workers;
+
+    static bool equalsIgnoreCase(string_view a, const char* b) {
+        size_t n = strlen(b);
+        if (a.size() != n) return false;
+        for (size_t i = 0; i < n; i++) {
+            if (TextSearch::fold((unsigned char)a[i]) != TextSearch::fold((unsigned char)b[i])) return false;
         }
-        else if (method == "POST" && endpoint == "/api/redo") {
-            redo();
-            saveToFile();
-            return "{\"success\":true,\"message\":\"Redo performed\"}";
+        return true;
+    }
+
+    static const char* statusText(int status) {
+        switch (status) {
+            case 200: return "OK";
+            case 204: return "No Content";
+            case 400: return "Bad Request";
+            case 404: return "Not Found";
+            case 409: return "Conflict";
+            case 413: return "Payload Too Large";
+            case 431: return "Request Header Fields Too Large";
+            case 500: return "Internal Server Error";
+            case 501: return "Not Implemented";
+            case 503: return "Service Unavailable";
+            default: return "Unknown";
         }
-        // Branch management endpoints
-        else if (method == "POST" && endpoint.find("/api/repositories/") == 0 && endpoint.find("/branches") != string::npos) {
-            // Extract repo name
-            size_t start = 17; // "/api/repositories/"
-            size_t end = endpoint.find("/branches");
-            string repoName = endpoint.substr(start, end - start);
-            Repository* repo = findRepo(repoName);
-            
-            if (repo) {
-                // Parse branch data (format: baseBranch=main&newBranch=feature)
-                size_t basePos = data.find("baseBranch=");
-                size_t newPos = data.find("newBranch=");
-                if (basePos != string::npos && newPos != string::npos) {
-                    string baseBranch = data.substr(basePos + 11, data.find("&", basePos) - basePos - 11);
-                    string newBranch = data.substr(newPos + 10);
-                    createBranch(repo, baseBranch, newBranch);
-                    saveToFile();
-                    return "{\"success\":true,\"message\":\"Branch created\"}";
+    }
+
+    void workerLoop() {
+        Poller poller;
+        poller.add(listener, true);
+        unordered_map<socket_t, Connection> connections;
+        vector<Poller::Event> events;
+        while (running) {
+            poller.wait(events, 100);     // Wake up regularly to notice stop()
+            for (const Poller::Event& event : events) {
+                if (event.fd == listener) {
+                    acceptAll(poller, connections);
+                    continue;
                 }
-            }
-        }
-        else if (method == "PUT" && endpoint.find("/api/repositories/") == 0 && endpoint.find("/branches/switch") != string::npos) {
-            // Extract repo name
-            size_t start = 17; // "/api/repositories/"
-            size_t end = endpoint.find("/branches");
-            string repoName = endpoint.substr(start, end - start);
-            Repository* repo = findRepo(repoName);
-            
-            if (repo) {
-                // Parse branch name (format: branchName=main)
-                size_t pos = data.find("branchName=");
-                if (pos != string::npos) {
-                    string branchName = data.substr(pos + 11);
-                    switchBranch(repo, branchName);
-                    saveToFile();
-                    return "{\"success\":true,\"message\":\"Branch switched\"}";
+                auto it = connections.find(event.fd);
+                if (it == connections.end()) continue;
+                Connection& c = it->second;
+                bool open = true;
+                if (event.readable && !c.closeAfterWrite) open = receive(c);
+                if (open) {
+                    serve(c);
+                    open = transmit(c);
                 }
-            }
-        }
-        else if (method == "POST" && endpoint.find("/api/repositories/") == 0 && endpoint.find("/branches/merge") != string::npos) {
-            // Extract repo name
-            size_t start = 17; // "/api/repositories/"
-            size_t end = endpoint.find("/branches");
-            string repoName = endpoint.substr(start, end - start);
-            Repository* repo = findRepo(repoName);
-            
-            if (repo) {
-                // Parse merge data (format: sourceBranch=feature&targetBranch=main)
-                size_t sourcePos = data.find("sourceBranch=");
-                size_t targetPos = data.find("targetBranch=");
-                if (sourcePos != string::npos && targetPos != string::npos) {
-                    string sourceBranch = data.substr(sourcePos + 13, data.find("&", sourcePos) - sourcePos - 13);
-                    string targetBranch = data.substr(targetPos + 13);
-                    mergeBranch(repo, sourceBranch, targetBranch);
-                    saveToFile();
-                    return "{\"success\":true,\"message\":\"Branch merged\"}";
+                bool pending = c.sent < c.out.size();
+                if (!open || (c.closeAfterWrite && !pending)) {
+                    poller.remove(c.fd);
+                    closeSocket(c.fd);
+                    connections.erase(it);
+                    continue;
+                }
+                if (pending != c.watchingWrite || c.closeAfterWrite) {
+                    poller.watch(c.fd, !c.closeAfterWrite, pending);
+                    c.watchingWrite = pending;
                 }
             }
         }
-        else if (method == "GET" && endpoint.find("/api/repositories/") == 0 && endpoint.find("/branches") != string::npos) {
-            // Extract repo name
-            size_t start = 17; // "/api/repositories/"
-            size_t end = endpoint.find("/branches");
-            string repoName = endpoint.substr(start, end - start);
-            Repository* repo = findRepo(repoName);
-            
-            if (repo) {
-                return repo->branchManager.getBranchesJSON();
+        for (auto& pair : connections) closeSocket(pair.first);
+    }
+
+    void acceptAll(Poller& poller, unordered_map<socket_t, Connection>& connections) {
+        while (true) {
+            socket_t fd = accept(listener, NULL, NULL);
+            if (fd == kInvalidSocket) return;     // Drained, or another worker took it
+#ifndef __linux__
+            if (!Poller::fits(fd)) { closeSocket(fd); continue; }
+#endif
+            setNonBlocking(fd);
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+            Connection& c = connections[fd];
+            c.fd = fd;
+            poller.add(fd);
+        }
+    }
+
+    // Read what the socket has. Returns false if the connection failed; a clean
+    // close from the peer still lets the requests already received be answered.
+    bool receive(Connection& c) {
+        char chunk[16384];
+        while (true) {
+            int n = (int)recv(c.fd, chunk, sizeof(chunk), 0);
+            if (n > 0) {
+                c.in.append(chunk, n);
+                if (n < (int)sizeof(chunk)) return true;
+                continue;
+            }
+            if (n == 0) {
+                c.closeAfterWrite = true;
+                return true;
             }
+            return socketWouldBlock();
         }
-        // Search endpoints
-        else if (method == "GET" && endpoint.find("/api/search/repos/") == 0) {
-            string term = endpoint.substr(18); // Remove "/api/search/repos/"
-            vector<string> results = searchRepositories(term);
-            
-            stringstream json;
-            json << "{\"results\":[";
-            for (size_t i = 0; i < results.size(); i++) {
-                if (i > 0) json << ",";
-                json << "\"" << results[i] << "\"";
-            }
-            json << "]}";
-            return json.str();
-        }
-        else if (method == "GET" && endpoint.find("/api/search/files/") == 0) {
-            // Format: /api/search/files/REPO_NAME/SEARCH_TERM?content=true
-            size_t repoEnd = endpoint.find("/", 17); // After "/api/search/files/"
-            if (repoEnd == string::npos) return "{\"error\":\"Invalid endpoint\"}";
-            
-            string repoName = endpoint.substr(17, repoEnd - 17);
-            string term = endpoint.substr(repoEnd + 1);
-            bool searchContent = (term.find("?content=true") != string::npos);
-            if (searchContent) {
-                term = term.substr(0, term.find("?"));
+    }
+
+    // Answer every complete request in the input buffer, in order
+    void serve(Connection& c) {
+        size_t consumed = 0;
+        bool peerClosed = c.closeAfterWrite;
+        while (c.out.size() - c.sent < kMaxPendingOutput) {
+            HttpRequest request;
+            int error = 0;
+            size_t length = parseRequest(&c.in[consumed], c.in.size() - consumed, request, error);
+            if (error) {
+                HttpResponse response;
+                response.status = error;
+                response.body = "{\"error\":\"" + string(statusText(error)) + "\"}";
+                appendResponse(c.out, response, false);
+                c.closeAfterWrite = true;
+                break;
             }
-            
-            Repository* repo = findRepo(repoName);
-            if (!repo) return "{\"error\":\"Repository not found\"}";
-            
-            vector<string> results = searchInRepository(repo, term, searchContent);
-            
-            stringstream json;
-            json << "{\"repository\":\"" << repoName << "\",\"results\":[";
-            for (size_t i = 0; i < results.size(); i++) {
-                if (i > 0) json << ",";
-                json << "\"" << results[i] << "\"";
+            if (!length) break;
+            HttpResponse response;
+            if (request.method == "OPTIONS") {
+                response.status = 204;      // CORS preflight from the browser UI
+            } else {
+                try {
+                    response = handler(request);
+                } catch (...) {
+                    response = HttpResponse();
+                    response.status = 500;
+                    response.body = "{\"error\":\"Internal server error\"}";
+                }
+            }
+            consumed += length;
+            bool keepAlive = request.keepAlive && !(peerClosed && consumed == c.in.size());
+            appendResponse(c.out, response, keepAlive);
+            if (!request.keepAlive) {
+                c.closeAfterWrite = true;
+                break;
             }
-            json << "]}";
-            return json.str();
         }
-        
-        return "{\"error\":\"Endpoint not found\"}";
+        c.in.erase(0, consumed);
+    }
+
+    bool transmit(Connection& c) {
+        while (c.sent < c.out.size()) {
+            int n = (int)send(c.fd, c.out.data() + c.sent, (int)min<size_t>(c.out.size() - c.sent, 1 << 30), kSendFlags);
+            if (n > 0) { c.sent += n; continue; }
+            if (n < 0 && socketWouldBlock()) break;
+            return false;
+        }
+        if (c.sent == c.out.size()) {
+            c.out.clear();
+            c.sent = 0;
+        } else if (c.sent >= (64 << 10)) {
+            c.out.erase(0, c.sent);
+            c.sent = 0;
+        }
+        return true;
     }
 };
 
-// -------------------- Web Server Simulation --------------------
+// -------------------- Web Server --------------------
+static const int kWebPort = 8080;
+
+// Serve the web UI's own files from the working directory. Only the pages and
+// assets named here are served: a target is never turned into a path, so it
+// cannot reach other files (data.json, the log, settings) or leave the directory.
+static bool serveStaticFile(string_view target, HttpResponse& response) {
+    static const struct { const char* path; const char* file; const char* type; } files[] = {
+        {"/", "index.html", "text/html; charset=utf-8"},
+        {"/index.html", "index.html", "text/html; charset=utf-8"},
+        {"/repo.html", "repo.html", "text/html; charset=utf-8"},
+        {"/script.js", "script.js", "application/javascript"},
+        {"/style.css", "style.css", "text/css"},
+    };
+    string_view path = target.substr(0, target.find('?'));
+    for (const auto& f : files) {
+        if (path != f.path) continue;
+        ifstream file(f.file, ios::binary);
+        if (!file) return false;
+        stringstream contents;
+        contents << file.rdbuf();
+        response.contentType = f.type;
+        response.body = contents.str();
+        return true;
+    }
+    return false;
+}
+
 void runWebServer(GitHub& git) {
-    cout << "Web server mode started. Data will be saved to data.json\n";
-    cout << "Open index.html in your browser to use the web interface.\n";
-    cout << "The data.json file will be created for the web interface.\n";
-    cout << "Press any key to exit...\n\n";
-    
-    git.loadFromFile();
+    cout << "Web server mode started. Changes are logged to data.wal and compacted into data.snapshot\n";
+    if (!git.loadFromFile()) return;
     git.saveToFile();
-    
-    cout << "Data saved to data.json. You can now use the web interface.\n";
-    cout << "To update data, restart this program and choose web mode again.\n";
+
+    // Workers call into GitHub concurrently; its route handlers do their own locking
+    HttpServer server([&](const HttpRequest& request) {
+        HttpResponse response;
+        if (request.target.compare(0, 5, "/api/") != 0) {
+            if (request.method != "GET" || !serveStaticFile(request.target, response)) {
+                response.status = 404;
+                response.body = "{\"error\":\"Not found\"}";
+            }
+            return response;
+        }
+        ApiResponse result = git.handleRequest(request.method, request.target, request.body, request.bodyLength);
+        response.status = result.status;
+        response.body = move(result.body);
+        string_view path = request.target.substr(0, request.target.find('?'));
+        if (path == "/api/metrics") response.contentType = "text/plain; version=0.0.4";
+        return response;
+    });
+    if (!server.start(kWebPort)) {
+        cout << "Could not listen on port " << kWebPort << ".\n";
+        return;
+    }
+    cout << "Serving the web interface and API on http://127.0.0.1:" << server.port() << "/\n";
+    cout << "Press Enter to stop the server...\n\n";
     
     // Wait for user input to exit
     cin.get();
+    server.stop();
 }
 
 // -------------------- MAIN --------------------
+// benchmarks.cpp includes this file with GITHUB_SIM_NO_MAIN defined
+#ifndef GITHUB_SIM_NO_MAIN
 int main() {
     GitHub git;
     int mode;
@@ -1374,3 +5695,4 @@ int main() {
         }
     } while(choice != 8);
 }
+#endif
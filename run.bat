@@ -4,7 +4,7 @@ echo    GitHub Simulator - C++ and Web
 echo ========================================
 echo.
 echo Compiling C++ GitHub Simulator...
-g++ -o github_simulator main.cpp
+g++ -std=c++17 -O2 -pthread -o github_simulator main.cpp -lws2_32
 if errorlevel 1 (
     echo.
     echo Compilation failed!
@@ -19,13 +19,13 @@ echo Starting GitHub Simulator...
 echo.
 echo Choose your preferred mode:
 echo   1 = Console Mode (Interactive CLI)
-echo   2 = Web Mode (Generate data for web interface)
+echo   2 = Web Mode (Serve the web interface at http://127.0.0.1:8080/)
 echo.
-echo Tip: Choose mode 2, then open index.html in your browser!
+echo Tip: Choose mode 2, then open http://127.0.0.1:8080/ in your browser!
 echo.
 github_simulator.exe
 echo.
-echo If you chose web mode, now open index.html in your browser
-echo to see the modern web interface with your data!
+echo Web mode stops serving when the simulator exits;
+echo your changes are kept in data.wal and data.snapshot.
 echo.
 pause
\ No newline at end of file
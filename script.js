@@ -1359,55 +1359,59 @@ function createBranchWithGraphUpdate(branchName, parentBranch = 'main') {
 }
 
 // --- Backend Communication ---
+// Set once the data came from the C++ engine (web mode); changes are then sent
+// to it. Without it the page keeps its own copy in localStorage.
+let backendAvailable = false;
+
 async function loadDataFromBackend() {
-    // First try to load from localStorage (user's changes)
-    if (loadFromLocalStorage()) {
-        return;
-    }
-    
-    // Then try to load from C++ backend data.json
-    try {
-        const response = await fetch('data.json');
-        if (response.ok) {
-            const data = await response.json();
-            repositories = data.repositories || [];
-            console.log('Data loaded from C++ backend:', repositories);
-            // Save to localStorage for persistence
-            
-            // Populate branch-specific commits from main commits array
-            repositories.forEach(repo => {
-                if (repo.commits && repo.branches) {
-                    repo.commits.forEach(commit => {
-                        const branchName = commit.branch || 'main';
-                        const targetBranch = repo.branches.find(b => b.name === branchName);
-                        if (targetBranch) {
-                            if (!targetBranch.commits) {
-                                targetBranch.commits = [];
-                            }
-                            // Add commit to branch if it doesn't already exist
-                            const exists = targetBranch.commits.some(c => 
-                                c.message === commit.message && 
-                                c.author === commit.author && 
-                                c.date === commit.date
-                            );
-                            if (!exists) {
-                                targetBranch.commits.push({...commit});
+    // Served by the C++ engine: it holds the data
+    if (window.location.protocol.startsWith('http')) {
+        try {
+            const response = await fetch('/api/repositories');
+            if (response.ok) {
+                const data = await response.json();
+                repositories = data.repositories || [];
+                backendAvailable = true;
+                console.log('Data loaded from C++ backend:', repositories);
+                
+                // Populate branch-specific commits from main commits array
+                repositories.forEach(repo => {
+                    if (repo.commits && repo.branches) {
+                        repo.commits.forEach(commit => {
+                            const branchName = commit.branch || 'main';
+                            const targetBranch = repo.branches.find(b => b.name === branchName);
+                            if (targetBranch) {
+                                if (!targetBranch.commits) {
+                                    targetBranch.commits = [];
+                                }
+                                // Add commit to branch if it doesn't already exist
+                                const exists = targetBranch.commits.some(c => 
+                                    c.message === commit.message && 
+                                    c.author === commit.author && 
+                                    c.date === commit.date
+                                );
+                                if (!exists) {
+                                    targetBranch.commits.push({...commit});
+                                }
                             }
-                        }
-                    });
-                }
-            });
-            
-            localStorage.setItem('githubSimulatorData', JSON.stringify(repositories));
-            console.log('Fallback data loaded successfully with branch-specific commits');
-        } else {
-            console.log('No data.json found, using fallback data');
-            loadFallbackData();
+                        });
+                    }
+                });
+                
+                localStorage.setItem('githubSimulatorData', JSON.stringify(repositories));
+                return;
+            }
+        } catch (error) {
+            console.log('C++ backend not running:', error);
         }
-    } catch (error) {
-        console.log('Using fallback data - C++ backend not running');
-        loadFallbackData();
     }
+    
+    // Opened as a file or without the engine: the user's saved changes, else sample data
+    if (loadFromLocalStorage()) {
+        return;
+    }
+    console.log('Using fallback data');
+    loadFallbackData();
 }
 
 function loadFallbackData() {
@@ -1682,21 +1686,33 @@ This is private content that only the owner should see.`
     console.log('Fallback data loaded with branch-specific commits populated');
 }
 
-// Simulate API calls to C++ backend and save to localStorage
+// Send a change to the C++ engine as a form-encoded request and keep the local
+// copy in localStorage. An error status from the engine is shown and returned
+// as { success: false, status, error }.
 async function callBackendAPI(method, endpoint, data = null) {
-    // In a real implementation, this would make HTTP requests to the C++ server
-    // For now, we'll simulate the API calls and save data locally
     console.log(`API Call: ${method} ${endpoint}`, data);
-    
-    // Save current repositories to localStorage to persist changes
     localStorage.setItem('githubSimulatorData', JSON.stringify(repositories));
+    if (!backendAvailable) {
+        return { success: true, message: 'Saved locally' };
+    }
     
-    // Simulate API response
-    return new Promise((resolve) => {
-        setTimeout(() => {
-            resolve({ success: true, message: 'Operation completed' });
-        }, 100);
-    });
+    try {
+        const response = await fetch(endpoint, {
+            method,
+            body: data,
+            headers: { 'Content-Type': 'application/x-www-form-urlencoded' }
+        });
+        const result = await response.json().catch(() => ({}));
+        if (!response.ok) {
+            const error = result.error || `${response.status} ${response.statusText}`;
+            showNotification(`Server error: ${error}`, 'error');
+            return { success: false, status: response.status, error };
+        }
+        return result;
+    } catch (error) {
+        showNotification('Could not reach the C++ server', 'error');
+        return { success: false, error: error.message };
+    }
 }
 
 // Load data from localStorage if available
@@ -2331,7 +2347,7 @@ async function createRepository() {
     console.log('Initial commit added');
     
     // Call backend API
-    await callBackendAPI('POST', '/api/repositories', `name=${name}&description=${description}&isPrivate=${newRepo.isPrivate}`);
+    await callBackendAPI('POST', '/api/repositories', `name=${encodeURIComponent(name)}&description=${encodeURIComponent(description)}&isPrivate=${encodeURIComponent(newRepo.isPrivate)}`);
     
     closeModal('newRepoModal');
     renderDashboard();
@@ -2358,6 +2374,13 @@ async function saveRepoChanges() {
         return;
     }
     
+    // The engine keeps history and its log by repository name
+    if (backendAvailable && name !== currentRepoName) {
+        alert('Repositories cannot be renamed while connected to the C++ server');
+        return;
+    }
+    const repoPath = `/api/repositories/${encodeURIComponent(currentRepoName)}`;
+    
     // Save state for undo
     saveStateForUndo('EDIT_REPO', `Edited repository: ${currentRepoName}`);
     
@@ -2393,7 +2416,7 @@ async function saveRepoChanges() {
     }
     
     // Save changes
-    await callBackendAPI('PUT', `/api/repositories/${currentRepoName}`, `name=${name}&description=${description}`);
+    await callBackendAPI('PUT', repoPath, `name=${encodeURIComponent(name)}&description=${encodeURIComponent(description)}&isPrivate=${isPrivate}`);
     
     closeModal('editRepoModal');
     renderDashboard();
@@ -2481,7 +2504,7 @@ async function createNewFile() {
     
     // Call backend API
     await callBackendAPI('POST', `/api/repositories/${currentRepoName}/files`, 
-        `name=${fullFileName}&content=${content}`);
+        `name=${encodeURIComponent(fullFileName)}&content=${encodeURIComponent(content)}`);
     
     closeModal('newFileModal');
     showSection('files');
@@ -2554,7 +2577,7 @@ async function saveFileChanges() {
     
     // Save changes
     await callBackendAPI('PUT', `/api/repositories/${currentRepoName}/files/${currentFileName}`, 
-        `name=${fileName}&content=${fileContent}`);
+        `name=${encodeURIComponent(fileName)}&content=${encodeURIComponent(fileContent)}`);
     
     closeModal('editFileModal');
     showSection('files');
@@ -2642,7 +2665,7 @@ async function uploadFile() {
             
             // Save changes
             await callBackendAPI('POST', `/api/repositories/${currentRepoName}/files`, 
-                `name=${fullFileName}&content=${content}`);
+                `name=${encodeURIComponent(fullFileName)}&content=${encodeURIComponent(content)}`);
             
             showSection('files');
         };
@@ -3136,7 +3159,7 @@ async function createNewBranch() {
     // Call backend API
     try {
         await callBackendAPI('POST', `/api/repositories/${currentRepoName}/branches`, 
-            `baseBranch=${baseBranch}&newBranch=${newBranchName}`);
+            `baseBranch=${encodeURIComponent(baseBranch)}&newBranch=${encodeURIComponent(newBranchName)}`);
     } catch (error) {
         console.error('Error creating branch:', error);
     }
@@ -3199,7 +3222,7 @@ async function switchToBranch(branchName) {
     // Call backend API
     try {
         await callBackendAPI('PUT', `/api/repositories/${currentRepoName}/branches/switch`, 
-            `branchName=${branchName}`);
+            `branchName=${encodeURIComponent(branchName)}`);
     } catch (error) {
         console.error('Error switching branch:', error);
     }
@@ -3324,7 +3347,7 @@ async function mergeBranches() {
     // Call backend API
     try {
         await callBackendAPI('POST', `/api/repositories/${currentRepoName}/branches/merge`, 
-            `sourceBranch=${sourceBranch}&targetBranch=${targetBranch}`);
+            `sourceBranch=${encodeURIComponent(sourceBranch)}&targetBranch=${encodeURIComponent(targetBranch)}`);
     } catch (error) {
         console.error('Error merging branches:', error);
     }
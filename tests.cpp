@@ -0,0 +1,486 @@
+// Behaviour tests for the GitHub simulator engine.
+// Build: g++ -std=c++17 -O2 -pthread -o tests tests.cpp (add -lws2_32 on Windows)
+// Run:   ./tests [restart tasks merge status log damage concurrent search history]
+// Each suite works in its own scratch directory, so the data files next to the
+// binary are left alone. Exits non-zero if any check fails.
+#define GITHUB_SIM_NO_MAIN
+#include "main.cpp"
+#include <chrono>
+#include <thread>
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+static int failures = 0;
+
+// Written with printf: the engine's own console output is muted while a suite runs
+static void check(bool ok, const string& what) {
+    printf("  %-6s%s\n", ok ? "ok" : "FAIL", what.c_str());
+    if (!ok) failures++;
+}
+
+// Run a suite quietly in an empty directory of its own and go back afterwards.
+// Console output goes to a buffer that drops it rather than to no buffer at all,
+// so threads writing at once do not all set the stream's error state.
+template <typename Fn>
+static void inScratchDirectory(const char* name, Fn fn) {
+    struct NullBuffer : streambuf {
+        int overflow(int c) override { return c; }
+    } discard;
+    filesystem::path previous = filesystem::current_path();
+    filesystem::path scratch = filesystem::temp_directory_path() / ("github_sim_" + string(name));
+    filesystem::remove_all(scratch);
+    filesystem::create_directories(scratch);
+    filesystem::current_path(scratch);
+    streambuf* console = cout.rdbuf(&discard);
+    fn();
+    cout.rdbuf(console);
+    filesystem::current_path(previous);
+    filesystem::remove_all(scratch);
+}
+
+// -------------------- Restart --------------------
+// Every commit on every branch as "repo branch hash date" lines
+static string commitFingerprint(GitHub& git, const vector<string>& repoNames) {
+    string out;
+    for (const string& name : repoNames) {
+        Repository* repo = git.findRepo(name);
+        if (!repo) { out += name + " missing\n"; continue; }
+        for (Branch* branch : repo->branchManager.sortedBranches()) {
+            for (const CommitNode* node : repo->branchManager.branchHistory(branch)) {
+                out += name + " " + branch->branchName.str() + " " + node->id() + " " + node->date() + "\n";
+            }
+        }
+    }
+    return out;
+}
+
+// Mutations replayed from the log after a restart rebuild the same commits,
+// dates and hashes included, rather than restamping them with the replay time
+static void testRestart() {
+    printf("\nRestart\n");
+    inScratchDirectory("restart", [] {
+        vector<string> repoNames = {"LeetCode", "demo"};
+        string before;
+        {
+            GitHub git;
+            git.loadFromFile();
+            git.handleRequest("POST", "/api/repositories", "name=demo&description=restart");
+            git.handleRequest("PUT", "/api/repositories/demo", "description=edited&isPrivate=true");
+            git.handleRequest("POST", "/api/repositories/demo/files", "name=a.txt&content=one");
+            git.handleRequest("POST", "/api/repositories/demo/branches", "baseBranch=main&newBranch=feature");
+            git.handleRequest("PUT", "/api/repositories/demo/branches/switch", "branchName=feature");
+            git.handleRequest("PUT", "/api/repositories/demo/files/a.txt", "content=two");
+            git.handleRequest("POST", "/api/repositories/demo/files", "name=b.txt&content=three");
+            git.handleRequest("PUT", "/api/repositories/demo/branches/switch", "branchName=main");
+            git.handleRequest("POST", "/api/repositories/demo/branches/merge", "sourceBranch=feature&targetBranch=main");
+            git.handleRequest("PUT", "/api/repositories/demo/files/b.txt", "name=c.txt&content=renamed");
+            git.handleRequest("DELETE", "/api/repositories/demo/files/a.txt");
+            git.handleRequest("POST", "/api/undo");
+            before = commitFingerprint(git, repoNames);
+        }
+        check(before.find("missing") == string::npos && !before.empty(), "mutations made commits");
+
+        // Replay in a later second than the one the commits were made in
+        time_t made = time(0);
+        while (time(0) == made) this_thread::sleep_for(chrono::milliseconds(50));
+
+        {
+            GitHub git;
+            git.loadFromFile();
+            check(commitFingerprint(git, repoNames) == before, "log replay keeps commit dates and hashes");
+            git.compact();
+        }
+        {
+            GitHub git;
+            git.loadFromFile();
+            check(commitFingerprint(git, repoNames) == before, "snapshot keeps commit dates and hashes");
+        }
+    });
+}
+
+// -------------------- Task Queue Restart --------------------
+// Queued tasks in order, without claiming them
+static vector<string> queuedTasks(GitHub& git, const string& repoName) {
+    vector<string> tasks;
+    Repository* repo = git.findRepo(repoName);
+    if (!repo) return tasks;
+    repo->tasks.popBatch(tasks, repo->tasks.capacity());
+    for (const string& task : tasks) repo->tasks.push(task);
+    return tasks;
+}
+
+// An accepted task survives a restart and a claimed one does not come back,
+// whether the restart replays the log or loads a compacted snapshot
+static void testTaskRestart() {
+    printf("\nTask queue restart\n");
+    inScratchDirectory("tasks", [] {
+        {
+            GitHub git;
+            git.loadFromFile();
+            git.handleRequest("POST", "/api/repositories", "name=demo");
+            git.handleRequest("POST", "/api/repositories/demo/tasks", "task=a");
+            git.compact();
+            git.handleRequest("POST", "/api/repositories/demo/tasks", "task=b");
+            git.handleRequest("POST", "/api/repositories/demo/tasks", "task=c");
+            string claimed = git.handleRequest("POST", "/api/repositories/demo/tasks/claim", "max=1").body;
+            check(claimed.find("[\"a\"]") != string::npos, "claim answers the oldest task");
+        }
+        {
+            GitHub git;
+            git.loadFromFile();
+            check(queuedTasks(git, "demo") == vector<string>{"b", "c"}, "log replay keeps accepted tasks and drops claimed ones");
+            git.handleRequest("POST", "/api/repositories/demo/tasks/claim", "max=1");
+            git.compact();
+        }
+        {
+            GitHub git;
+            git.loadFromFile();
+            check(queuedTasks(git, "demo") == vector<string>{"c"}, "snapshot keeps the queue after a claim");
+        }
+    });
+}
+
+// -------------------- Merge Results --------------------
+// The merge response reports what the merge changed and which files conflict
+static void testMergeResults() {
+    printf("\nMerge results\n");
+    inScratchDirectory("merge", [] {
+        GitHub git;
+        auto request = [&](string_view method, string_view endpoint, string_view body = "") {
+            return git.handleRequest(method, endpoint, body).body;
+        };
+        request("POST", "/api/repositories", "name=demo");
+        request("POST", "/api/repositories/demo/files", "name=a.txt&content=one");
+        request("POST", "/api/repositories/demo/files", "name=c.txt&content=base");
+        request("POST", "/api/repositories/demo/branches", "baseBranch=main&newBranch=feature");
+        request("PUT", "/api/repositories/demo/branches/switch", "branchName=feature");
+        request("PUT", "/api/repositories/demo/files/a.txt", "content=two");
+        request("POST", "/api/repositories/demo/files", "name=b.txt&content=new");
+        request("PUT", "/api/repositories/demo/branches/switch", "branchName=main");
+        string clean = request("POST", "/api/repositories/demo/branches/merge", "sourceBranch=feature&targetBranch=main");
+        check(clean.find("\"filesAdded\":1,\"filesUpdated\":1,\"filesDeleted\":0") != string::npos, "clean merge counts added and updated files");
+        check(clean.find("\"conflicts\":[]") != string::npos, "clean merge has no conflicts");
+
+        request("POST", "/api/repositories/demo/branches", "baseBranch=main&newBranch=other");
+        request("PUT", "/api/repositories/demo/branches/switch", "branchName=other");
+        request("PUT", "/api/repositories/demo/files/c.txt", "content=theirs");
+        request("PUT", "/api/repositories/demo/branches/switch", "branchName=main");
+        request("PUT", "/api/repositories/demo/files/c.txt", "content=ours");
+        string conflicting = request("POST", "/api/repositories/demo/branches/merge", "sourceBranch=other&targetBranch=main");
+        check(conflicting.find("\"conflicts\":[\"c.txt\"]") != string::npos, "conflicting merge names the conflicted file");
+        check(conflicting.find("\"filesUpdated\":0") != string::npos, "conflicted file is not counted as updated");
+    });
+}
+
+// -------------------- Status Codes --------------------
+// Each API failure answers with the status that fits it
+static void testStatusCodes() {
+    printf("\nStatus codes\n");
+    inScratchDirectory("status", [] {
+        GitHub git;
+        auto status = [&](string_view method, string_view endpoint, string_view body = "") {
+            return git.handleRequest(method, endpoint, body).status;
+        };
+        check(status("POST", "/api/repositories", "name=demo") == 200, "created repository answers 200");
+        check(status("POST", "/api/repositories", "name=demo") == 409, "existing repository answers 409");
+        check(status("PUT", "/api/repositories/demo", "description=edited") == 200, "edited repository answers 200");
+        check(status("PUT", "/api/repositories/demo", "name=other") == 400, "renamed repository answers 400");
+        check(status("PUT", "/api/repositories/missing", "description=edited") == 404, "unknown repository edit answers 404");
+        check(status("POST", "/api/repositories", "description=none") == 400, "missing name answers 400");
+        check(status("POST", "/api/repositories", "{\"name\":") == 400, "malformed body answers 400");
+        check(status("GET", "/api/nowhere") == 404, "unknown endpoint answers 404");
+        check(status("POST", "/api/repositories/missing/files", "name=a&content=b") == 404, "unknown repository answers 404");
+        check(status("POST", "/api/repositories/demo/files", "name=a&content=b") == 200, "created file answers 200");
+        check(status("POST", "/api/repositories/demo/files", "name=a&content=c") == 409, "existing file answers 409");
+        check(status("DELETE", "/api/repositories/demo/files/b") == 404, "unknown file answers 404");
+        check(status("PUT", "/api/repositories/demo/branches/switch", "branchName=nope") == 404, "unknown branch answers 404");
+        check(status("POST", "/api/repositories/demo/branches", "baseBranch=main&newBranch=main") == 409, "existing branch answers 409");
+        size_t capacity = git.findRepo("demo")->tasks.capacity();
+        for (size_t i = 0; i < capacity; i++) git.handleRequest("POST", "/api/repositories/demo/tasks", "task=t");
+        check(status("POST", "/api/repositories/demo/tasks", "task=t") == 503, "full task queue answers 503");
+
+        auto parseError = [](string raw) {
+            HttpRequest request;
+            int error = 0;
+            HttpServer::parseRequest(&raw[0], raw.size(), request, error);
+            return error;
+        };
+        string head = "POST /api/undo HTTP/1.1\r\nHost: x\r\n";
+        check(parseError(head + "Content-Length: 5\r\nContent-Length: 6\r\n\r\nhello!") == 400, "disagreeing Content-Length headers answer 400");
+        check(parseError(head + "Content-Length: 5, 6\r\n\r\nhello!") == 400, "disagreeing Content-Length list answers 400");
+        check(parseError(head + "Content-Length: 5\r\nContent-Length: 5, 5\r\n\r\nhello") == 0, "agreeing Content-Length headers are accepted");
+    });
+}
+
+// -------------------- Log Write Failures --------------------
+// A log write that fails part way answers 500, leaves no torn record behind and
+// is written by the next request. A file size limit makes the write fail.
+static void testLogWriteFailure() {
+    printf("\nLog write failures\n");
+#ifdef _WIN32
+    printf("  skipped: needs a file size limit\n");
+#else
+    inScratchDirectory("log", [] {
+        {
+            GitHub git;
+            git.loadFromFile();
+            size_t logBytes = filesystem::file_size("data.wal");
+            rlimit previous;
+            getrlimit(RLIMIT_FSIZE, &previous);
+            rlimit limited = previous;
+            limited.rlim_cur = logBytes + 16;
+            signal(SIGXFSZ, SIG_IGN);
+            setrlimit(RLIMIT_FSIZE, &limited);
+            int failed = git.handleRequest("POST", "/api/repositories", "name=first&description=" + string(256, 'x')).status;
+            setrlimit(RLIMIT_FSIZE, &previous);
+            signal(SIGXFSZ, SIG_DFL);
+            check(failed == 500, "failed write answers 500");
+            check(filesystem::file_size("data.wal") == logBytes, "torn record is cut off");
+            check(git.handleRequest("POST", "/api/repositories", "name=second").status == 200, "next write succeeds");
+        }
+        GitHub git;
+        git.loadFromFile();
+        check(git.findRepo("first") && git.findRepo("second"), "both changes are replayed");
+    });
+#endif
+}
+
+// -------------------- Damaged Snapshots --------------------
+static string readBytes(const char* path) {
+    ifstream in(path, ios::binary);
+    stringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+static void flipByte(const char* path, size_t offset) {
+    string bytes = readBytes(path);
+    bytes[offset] ^= 0x20;
+    ofstream(path, ios::binary | ios::trunc) << bytes;
+}
+
+// Five repositories with a file each, folded into a snapshot
+static void writeStore() {
+    GitHub git;
+    git.loadFromFile();
+    for (int i = 0; i < 5; i++) {
+        string name = "repo" + to_string(i);
+        git.handleRequest("POST", "/api/repositories", "name=" + name);
+        git.handleRequest("POST", "/api/repositories/" + name + "/files", "name=a.txt&content=" + name);
+    }
+    git.compact();
+}
+
+// One damaged byte must not lose the store: the snapshot is neither replaced
+// by an empty one nor rewritten without the damaged repository
+static void testDamagedSnapshot() {
+    printf("\nDamaged snapshots\n");
+    inScratchDirectory("damage", [] {
+        writeStore();
+        flipByte("data.snapshot", filesystem::file_size("data.snapshot") - 20);    // In the directory
+        string damaged = readBytes("data.snapshot");
+        {
+            GitHub git;
+            check(!git.loadFromFile(), "damaged directory keeps the store closed");
+            git.handleRequest("POST", "/api/repositories", "name=after");
+            git.compact();
+        }
+        check(readBytes("data.snapshot") == damaged, "damaged directory is not overwritten");
+
+        filesystem::remove("data.snapshot");
+        filesystem::remove("data.wal");
+        writeStore();
+        flipByte("data.snapshot", 60);      // In the first section, the oldest repository's
+        damaged = readBytes("data.snapshot");
+        GitHub git;
+        check(git.loadFromFile(), "damaged section still opens the store");
+        git.handleRequest("GET", "/api/repositories/LeetCode/branches");
+        check(git.handleRequest("POST", "/api/repositories/repo0/files", "name=b.txt&content=x").status == 500,
+              "changes after a damaged section answer 500");
+        git.compact();
+        check(readBytes("data.snapshot") == damaged, "damaged section is not overwritten");
+    });
+}
+
+// -------------------- Concurrent Access --------------------
+// The number after "key": in a JSON answer
+static size_t jsonCount(const string& json, const string& key) {
+    size_t at = json.find("\"" + key + "\":");
+    return at == string::npos ? 0 : strtoul(json.c_str() + at + key.size() + 3, NULL, 10);
+}
+
+// Several threads call the web API of one instance at once. Each writer owns a
+// repository and creates, edits and deletes files and creates and merges
+// branches in it, one thread keeps creating and deleting a scratch repository,
+// and readers list, page and search the whole time. Afterwards every writer's
+// files must be exactly what it wrote.
+static void testConcurrentAccess() {
+    const int writers = 4, readers = 4, rounds = 200;
+    printf("\nConcurrent access (%d writers, %d readers, %d rounds per writer)\n", writers, readers, rounds);
+    inScratchDirectory("concurrent", [&] {
+        GitHub git;
+        vector<map<string, string>> expected(writers);
+        atomic<bool> writing(true);
+        atomic<size_t> reads(0), undoable(0);
+        vector<thread> writerThreads, otherThreads;
+        for (int w = 0; w < writers; w++) {
+            writerThreads.emplace_back([&, w] {
+                string repoName = "stress-" + to_string(w);
+                string path = "/api/repositories/" + repoName;
+                git.handleRequest("POST", "/api/repositories", "name=" + repoName);
+                map<string, string>& files = expected[w];
+                for (int i = 0; i < rounds; i++) {
+                    string fileName = "file" + to_string(i % 16) + ".txt";
+                    string content = "writer-" + to_string(w) + "-round-" + to_string(i);
+                    if (files.count(fileName) && i % 3 == 0) {
+                        git.handleRequest("DELETE", path + "/files/" + fileName);
+                        files.erase(fileName);
+                    } else if (files.count(fileName)) {
+                        git.handleRequest("PUT", path + "/files/" + fileName, "content=" + content);
+                        files[fileName] = content;
+                    } else {
+                        git.handleRequest("POST", path + "/files", "name=" + fileName + "&content=" + content);
+                        files[fileName] = content;
+                    }
+                    if (i % 20 == 0) {
+                        string branch = "branch" + to_string(i);
+                        git.handleRequest("POST", path + "/branches", "baseBranch=main&newBranch=" + branch);
+                        git.handleRequest("POST", path + "/branches/merge", "sourceBranch=" + branch + "&targetBranch=main");
+                    }
+                }
+                undoable += rounds + 1;
+            });
+        }
+        otherThreads.emplace_back([&] {
+            while (writing) {
+                git.handleRequest("POST", "/api/repositories", "name=scratch");
+                git.handleRequest("POST", "/api/repositories/scratch/files", "name=a.txt&content=scratch");
+                git.handleRequest("DELETE", "/api/repositories/scratch");
+                undoable += 3;
+            }
+        });
+        for (int r = 0; r < readers; r++) {
+            otherThreads.emplace_back([&, r] {
+                string path = "stress-" + to_string(r % writers);
+                while (writing) {
+                    git.handleRequest("GET", "/api/repositories");
+                    git.handleRequest("GET", "/api/repositories?limit=2&fields=name,files");
+                    git.handleRequest("GET", "/api/repositories/" + path + "/branches");
+                    git.handleRequest("GET", "/api/search/repos/stress");
+                    git.handleRequest("GET", "/api/search/files/" + path + "/round?content=true");
+                    reads += 5;
+                }
+            });
+        }
+        for (thread& t : writerThreads) t.join();
+        writing = false;
+        for (thread& t : otherThreads) t.join();
+
+        bool consistent = true;
+        for (int w = 0; w < writers; w++) {
+            Repository* repo = git.findRepo("stress-" + to_string(w));
+            if (!repo || repo->getCurrentFiles()->size() != expected[w].size()) {
+                consistent = false;
+                continue;
+            }
+            for (const auto& file : expected[w]) {
+                const File* found = git.findFile(repo, file.first);
+                if (!found || found->content() != file.second) consistent = false;
+            }
+        }
+        string stacks = git.getStacksJSON(0, 0);
+        size_t undoCount = jsonCount(stacks, "undoCount");
+        check(reads > 0, "reads served meanwhile: " + to_string(reads));
+        check(consistent, "repository contents consistent");
+        check(undoCount == min<size_t>(undoable, jsonCount(stacks, "maxOperations")), "undo history complete");
+        check(!git.findRepo("scratch"), "scratch repository removed");
+
+        // A worker that read the catalog and then went idle must not keep a
+        // repository deleted after its read alive
+        git.handleRequest("POST", "/api/repositories", "name=doomed");
+        weak_ptr<Repository> doomed = git.catalog()->find("doomed");
+        mutex idleLock;
+        condition_variable idleChanged;
+        bool hasRead = false, release = false;
+        thread idle([&] {
+            git.handleRequest("GET", "/api/repositories/doomed/branches");
+            unique_lock<mutex> guard(idleLock);
+            hasRead = true;
+            idleChanged.notify_all();
+            idleChanged.wait(guard, [&] { return release; });
+        });
+        {
+            unique_lock<mutex> guard(idleLock);
+            idleChanged.wait(guard, [&] { return hasRead; });
+        }
+        git.handleRequest("DELETE", "/api/repositories/doomed");
+        check(doomed.expired(), "idle worker does not keep a deleted repository");
+        {
+            lock_guard<mutex> guard(idleLock);
+            release = true;
+        }
+        idleChanged.notify_all();
+        idle.join();
+    });
+}
+
+// -------------------- Content Index --------------------
+// Files that are added and removed over and over reuse document ids, and the
+// reused ids still find the right files
+static void testContentIndex() {
+    printf("\nContent index\n");
+    TrigramIndex index;
+    index.add("keep.txt", "needle in a haystack");
+    for (int i = 0; i < 1000; i++) {
+        string name = "churn" + to_string(i) + ".txt";
+        index.add(name, "short-lived needle");
+        index.remove(name, "short-lived needle");
+    }
+    check(index.docNames.size() == 2, "removed ids are reused");
+    index.add("late.txt", "a needle added later");
+    index.add("new.txt", "another needle");
+    vector<string> found = index.candidates("needle");
+    sort(found.begin(), found.end());
+    check(found == vector<string>{"keep.txt", "late.txt", "new.txt"}, "search finds files under reused ids");
+    index.update("keep.txt", "needle in a haystack", "hay only");
+    check(index.candidates("needle").size() == 2, "edited file leaves the postings");
+}
+
+// -------------------- Commit Messages --------------------
+// Names typed by users are kept whole, ": " and all, and are not interned
+static void testCommitMessages() {
+    printf("\nCommit messages\n");
+    inScratchDirectory("history", [] {
+        GitHub git;
+        git.handleRequest("POST", "/api/repositories", "name=demo");
+        size_t symbols = SymbolTable::instance().size();
+        git.handleRequest("POST", "/api/repositories/demo/files", "name=notes: draft.txt&content=x");
+        git.handleRequest("POST", "/api/repositories/demo/files", "name=Merged branch.txt&content=y");
+        Repository* repo = git.findRepo("demo");
+        vector<const CommitNode*> history = repo->branchManager.branchHistory(repo->branchManager.getCurrentBranch());
+        check(history.size() == 2, "each file made a commit");
+        if (history.size() == 2) {
+            check(history[0]->action() == "Created File: notes: draft.txt", "message with \": \" in the name is kept whole");
+            check(history[1]->action() == "Created File: Merged branch.txt", "message with a verb in the name is kept whole");
+            check(history[0]->verb == history[1]->verb, "both share the Created File verb");
+        }
+        check(SymbolTable::instance().size() == symbols, "file names are not interned");
+    });
+}
+
+int main(int argc, char** argv) {
+    static const struct { const char* name; void (*run)(); } suites[] = {
+        {"restart", testRestart}, {"tasks", testTaskRestart}, {"merge", testMergeResults}, {"status", testStatusCodes}, {"log", testLogWriteFailure},
+        {"damage", testDamagedSnapshot}, {"concurrent", testConcurrentAccess}, {"search", testContentIndex}, {"history", testCommitMessages},
+    };
+    vector<string> selected(argv + 1, argv + argc);
+    printf("GitHub simulator tests\n");
+    for (const auto& suite : suites) {
+        if (selected.empty() || find(selected.begin(), selected.end(), suite.name) != selected.end()) suite.run();
+    }
+    if (failures) printf("\n%d check(s) failed\n", failures);
+    else printf("\nAll checks passed\n");
+    return failures ? 1 : 0;
+}